@@ -0,0 +1,106 @@
+#ifndef ANTIALIASING_H
+#define ANTIALIASING_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+#include <learnopengl/gpu_timer.h>
+#include <learnopengl/render_graph.h>
+
+#include <algorithm>
+using namespace std;
+
+// the anti-aliasing modes of the scene. The window's framebuffer is single sampled in all of them, it only receives
+// the tone mapped fullscreen pass.
+//
+//   NONE   nothing
+//   FXAA   a post pass over the tone mapped image (fxaa.fs), the composite renders into an LDR target first
+//   MSAA   the scene targets (HDR color, bright pass, depth) are multisampled and resolved with glBlitFramebuffer
+//          before bloom and tone mapping. The GBuffer isn't, lighting it per sample would cost what deferred
+//          shading saves, so MSAA falls back to FXAA while deferred shading is on.
+//
+// The GPU time of the frame is kept per mode so the modes can be compared side by side.
+class AntiAliasing
+{
+public:
+    enum Mode { NONE, FXAA, MSAA, MODE_COUNT };
+    // samples of the MSAA targets, less if the driver can't do that many
+    static const unsigned int MSAA_SAMPLES = 4;
+    // frames after a mode switch that are not recorded, the timers lag and are smoothed
+    static const unsigned int SETTLE_FRAMES = 60;
+
+    AntiAliasing(Shader &fxaa, unsigned int quadVAO) : fxaa(fxaa), quadVAO(quadVAO), lastMode(NONE), framesInMode(0)
+    {
+        GLint colorSamples = 1, depthSamples = 1;
+        glGetIntegerv(GL_MAX_COLOR_TEXTURE_SAMPLES, &colorSamples);
+        glGetIntegerv(GL_MAX_DEPTH_TEXTURE_SAMPLES, &depthSamples);
+        maxSamples = std::max(1, std::min(colorSamples, depthSamples));
+        for (int i = 0; i < MODE_COUNT; i++)
+            milliseconds[i] = 0.0;
+    }
+
+    static const char *Name(int mode)
+    {
+        switch (mode)
+        {
+            case FXAA: return "FXAA";
+            case MSAA: return "MSAA";
+            default: return "Off";
+        }
+    }
+
+    // the mode that actually runs
+    static int Effective(int mode, bool deferred)
+    {
+        return mode == MSAA && deferred ? FXAA : mode;
+    }
+
+    // samples of the scene targets in mode
+    unsigned int Samples(int mode) const
+    {
+        if (mode != MSAA)
+            return 1;
+        return maxSamples < MSAA_SAMPLES ? maxSamples : MSAA_SAMPLES;
+    }
+
+    // adds the pass that filters the tone mapped ldr target into the window
+    void AddFxaaPass(RenderGraph &graph, RenderGraph::Resource ldr, GpuTimer *timer = nullptr)
+    {
+        graph.AddPass("FXAA", [this, &graph, ldr]() {
+            static constexpr UniformHandle<int> IMAGE("image");
+            fxaa.use();
+            fxaa.set(IMAGE, 0);
+            glDisable(GL_DEPTH_TEST);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.Texture(ldr));
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            glBindVertexArray(0);
+            glEnable(GL_DEPTH_TEST);
+        }).Read(ldr).Write(RenderGraph::BACKBUFFER, false).SideEffect().Time(timer);
+    }
+
+    // GPU time of the latest frame, rendered in mode
+    void Record(int mode, double gpuMilliseconds)
+    {
+        if (mode != lastMode)
+        {
+            lastMode = mode;
+            framesInMode = 0;
+        }
+        if (++framesInMode > SETTLE_FRAMES && gpuMilliseconds > 0.0)
+            milliseconds[mode] = gpuMilliseconds;
+    }
+
+    // GPU time of a frame in mode, 0 until it ran long enough to be measured
+    double Milliseconds(int mode) const { return milliseconds[mode]; }
+
+private:
+    Shader &fxaa;
+    unsigned int quadVAO;
+    unsigned int maxSamples;
+    int lastMode;
+    unsigned int framesInMode;
+    double milliseconds[MODE_COUNT];
+};
+#endif
@@ -0,0 +1,211 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// command line of the headless benchmark:
+//
+//     Farming_Life --benchmark [--path resources/camera_paths/flyover.txt | --replay camera_recording.bin]
+//                  [--frames 600] [--warmup 60] [--size 1280x720] [--deferred] [--prepass] [--aa off|fxaa|msaa]
+//                  [--report benchmark_report.json]
+//
+// --replay flies a CameraRecorder recording instead of a path, on the recorder's playback step; --frames is ignored
+// then. The report is JSON unless its name ends in .csv.
+struct BenchmarkOptions {
+    bool enabled = false;
+    string cameraPath = "resources/camera_paths/flyover.txt";
+    string replay;
+    unsigned int frames = 600;
+    unsigned int warmupFrames = 60;
+    unsigned int width = 1280, height = 720;
+    bool deferred = false;
+    bool prepass = false;
+    int antiAliasing = 2;  // AntiAliasing::Mode
+    string report = "benchmark_report.json";
+
+    // false on a malformed command line, the usage is printed then
+    bool Parse(int argc, char **argv)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            string arg = argv[i];
+            const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+            if (arg == "--benchmark")
+                enabled = true;
+            else if (arg == "--deferred")
+                deferred = true;
+            else if (arg == "--prepass")
+                prepass = true;
+            else if (!value)
+                return usage(argv[0], arg);
+            else if (arg == "--path")
+                cameraPath = argv[++i];
+            else if (arg == "--replay")
+                replay = argv[++i];
+            else if (arg == "--report")
+                report = argv[++i];
+            else if (arg == "--frames" && parseCount(value, frames) && frames > 0)
+                i++;
+            else if (arg == "--warmup" && parseCount(value, warmupFrames))
+                i++;
+            else if (arg == "--size" && sscanf(value, "%ux%u", &width, &height) == 2 && width > 0 && height > 0)
+                i++;
+            else if (arg == "--aa" && parseAntiAliasing(value))
+                i++;
+            else
+                return usage(argv[0], arg);
+        }
+        return true;
+    }
+
+    bool Csv() const
+    {
+        return report.size() >= 4 && report.compare(report.size() - 4, 4, ".csv") == 0;
+    }
+
+private:
+    static bool parseCount(const char *value, unsigned int &count)
+    {
+        char *end = nullptr;
+        long parsed = strtol(value, &end, 10);
+        if (*value == '\0' || *end != '\0' || parsed < 0)
+            return false;
+        count = (unsigned int)parsed;
+        return true;
+    }
+
+    bool parseAntiAliasing(const char *value)
+    {
+        static const char *names[] = {"off", "fxaa", "msaa"};
+        for (int mode = 0; mode < 3; mode++)
+            if (strcmp(value, names[mode]) == 0)
+            {
+                antiAliasing = mode;
+                return true;
+            }
+        return false;
+    }
+
+    static bool usage(const char *program, const string &arg)
+    {
+        std::cout << "ERROR::BENCHMARK:: unexpected argument " << arg << "\n"
+                  << "usage: " << program << " [--benchmark [--path <camera path> | --replay <recording>] [--frames <n>] [--warmup <n>]"
+                  << " [--size <width>x<height>] [--deferred] [--prepass] [--aa off|fxaa|msaa] [--report <file.json|file.csv>]]"
+                  << std::endl;
+        return false;
+    }
+};
+
+// frame times of a benchmark run and their summary. Frame time is the wall time from one frame to the next, CPU time
+// the part of it the main thread spent until the frame was submitted, GPU time what the frame's timer measured.
+class BenchmarkRecorder
+{
+public:
+    struct Summary {
+        size_t count;
+        double mean, p50, p95, p99, min, max;
+    };
+
+    vector<double> frameMs, cpuMs, gpuMs;
+
+    // nearest rank percentiles
+    static Summary Summarize(vector<double> samples)
+    {
+        Summary summary = {samples.size(), 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        if (samples.empty())
+            return summary;
+        std::sort(samples.begin(), samples.end());
+        double sum = 0.0;
+        for (double sample : samples)
+            sum += sample;
+        summary.mean = sum / samples.size();
+        summary.p50 = percentile(samples, 50.0);
+        summary.p95 = percentile(samples, 95.0);
+        summary.p99 = percentile(samples, 99.0);
+        summary.min = samples.front();
+        summary.max = samples.back();
+        return summary;
+    }
+
+    // writes the report and prints the summary, renderer and settings describe the run
+    bool WriteReport(const BenchmarkOptions &options, const string &renderer, const string &settings) const
+    {
+        const char *names[] = {"frame_ms", "cpu_ms", "gpu_ms"};
+        Summary summaries[] = {Summarize(frameMs), Summarize(cpuMs), Summarize(gpuMs)};
+
+        std::cout << "Benchmark: " << renderer << ", " << settings << std::endl;
+        char line[160];
+        for (int i = 0; i < 3; i++)
+        {
+            snprintf(line, sizeof(line), "  %-8s mean %7.3f  p50 %7.3f  p95 %7.3f  p99 %7.3f  min %7.3f  max %7.3f  (%zu frames)",
+                     names[i], summaries[i].mean, summaries[i].p50, summaries[i].p95, summaries[i].p99,
+                     summaries[i].min, summaries[i].max, summaries[i].count);
+            std::cout << line << std::endl;
+        }
+
+        std::ofstream out(options.report, std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::BENCHMARK:: could not write " << options.report << std::endl;
+            return false;
+        }
+        if (options.Csv())
+        {
+            out << "metric,frames,mean,p50,p95,p99,min,max\n";
+            for (int i = 0; i < 3; i++)
+            {
+                snprintf(line, sizeof(line), "%s,%zu,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", names[i], summaries[i].count,
+                         summaries[i].mean, summaries[i].p50, summaries[i].p95, summaries[i].p99, summaries[i].min,
+                         summaries[i].max);
+                out << line;
+            }
+        }
+        else
+        {
+            const string &camera = options.replay.empty() ? options.cameraPath : options.replay;
+            out << "{\n  \"renderer\": \"" << escape(renderer) << "\",\n  \"settings\": \"" << escape(settings)
+                << "\",\n  \"camera_path\": \"" << escape(camera) << "\",\n  \"width\": " << options.width
+                << ",\n  \"height\": " << options.height << ",\n  \"warmup_frames\": " << options.warmupFrames;
+            for (int i = 0; i < 3; i++)
+            {
+                snprintf(line, sizeof(line), "{\"frames\": %zu, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"min\": %.4f, \"max\": %.4f}",
+                         summaries[i].count, summaries[i].mean, summaries[i].p50, summaries[i].p95, summaries[i].p99,
+                         summaries[i].min, summaries[i].max);
+                out << ",\n  \"" << names[i] << "\": " << line;
+            }
+            out << "\n}\n";
+        }
+        std::cout << "Benchmark report written to " << options.report << std::endl;
+        return bool(out);
+    }
+
+private:
+    static double percentile(const vector<double> &sorted, double p)
+    {
+        size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+        return sorted[rank > 0 ? rank - 1 : 0];
+    }
+
+    static string escape(const string &text)
+    {
+        string result;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            if ((unsigned char)c >= 0x20)
+                result += c;
+        }
+        return result;
+    }
+};
+#endif
@@ -0,0 +1,84 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+#include <learnopengl/render_graph.h>
+
+#include <string>
+#include <vector>
+using namespace std;
+
+// progressive bloom blur on a mip-like chain of render targets at 1/2, 1/4, 1/8, ... of the screen. The bright pass
+// is downsampled level by level (bloom_downsample.fs), then upsampled back to the first level (bloom_upsample.fs);
+// both are dual filter kernels made of bilinear taps, so every level costs one small pass and the glow widens with
+// every level of the chain.
+//
+// The levels are transient R11F_G11F_B10F targets of the render graph, half the bytes of RGBA16F, the glow needs
+// neither alpha nor the extra precision.
+class Bloom
+{
+public:
+    static const unsigned int MAX_LEVELS = 8;
+
+    Bloom(Shader &downsample, Shader &upsample, unsigned int quadVAO) : downsample(downsample), upsample(upsample), quadVAO(quadVAO)
+    {
+    }
+
+    // adds the passes that blur bright (full resolution) and returns the half resolution result. levels is clamped
+    // to [1, MAX_LEVELS] and to what the graph size allows.
+    RenderGraph::Resource AddPasses(RenderGraph &graph, RenderGraph::Resource bright, unsigned int levels, GpuTimer *timer = nullptr)
+    {
+        levels = levels < 1 ? 1 : levels > MAX_LEVELS ? MAX_LEVELS : levels;
+        vector<RenderGraph::Resource> chain;
+        unsigned int levelWidth = graph.Width(), levelHeight = graph.Height();
+        for (unsigned int i = 0; i < levels; i++)
+        {
+            // a level needs at least two texels per side for the kernels to mean anything, the first one is always made
+            if (i > 0 && (levelWidth < 4 || levelHeight < 4))
+                break;
+            levelWidth /= 2;
+            levelHeight /= 2;
+            chain.push_back(graph.Create("Bloom level " + std::to_string(i + 1), GL_R11F_G11F_B10F, 1.0f / float(2u << i)));
+        }
+
+        RenderGraph::Resource input = bright;
+        for (size_t i = 0; i < chain.size(); i++)
+        {
+            graph.AddPass("Bloom downsample " + std::to_string(i + 1), [this, &graph, input]() { draw(graph, downsample, input); })
+                .Read(input).Write(chain[i], false).Time(timer);
+            input = chain[i];
+        }
+        for (size_t i = chain.size() - 1; i > 0; i--)
+        {
+            RenderGraph::Resource source = chain[i];
+            graph.AddPass("Bloom upsample " + std::to_string(i), [this, &graph, source]() { draw(graph, upsample, source); })
+                .Read(source).Write(chain[i - 1], false).Time(timer);
+        }
+        return chain[0];
+    }
+
+private:
+    Shader &downsample;
+    Shader &upsample;
+    unsigned int quadVAO;
+
+    // one fullscreen pass reading source on texture unit 0, the graph has bound the target
+    void draw(const RenderGraph &graph, Shader &shader, RenderGraph::Resource source)
+    {
+        static constexpr UniformHandle<int> IMAGE("image");
+        static constexpr UniformHandle<glm::vec2> IMAGE_SCALE("imageScale");
+        shader.use();
+        shader.set(IMAGE, 0);
+        shader.set(IMAGE_SCALE, graph.UvScale(source));
+        glDisable(GL_DEPTH_TEST);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, graph.Texture(source));
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+    }
+};
+#endif
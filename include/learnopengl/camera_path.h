@@ -0,0 +1,119 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/camera.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+struct CameraKeyframe {
+    float time;
+    glm::vec3 position;
+    float yaw, pitch, zoom;
+};
+
+// a camera flight through keyframes, read from a text file with one keyframe per line:
+//
+//     # time  x y z  yaw pitch  [zoom]
+//     0.0     0 2 30  -90 -10  45
+//     5.0     15 2 22 -120 -8
+//
+// Times are in seconds and increasing. Sample interpolates linearly between the keyframes around a time and holds
+// the first and last keyframe outside of them. Yaw is not wrapped, -90 to -200 turns the short way and 180 to -180
+// turns all the way round.
+class CameraPath
+{
+public:
+    vector<CameraKeyframe> keyframes;
+
+    bool Load(const string &path)
+    {
+        keyframes.clear();
+        std::ifstream in(path);
+        if (!in)
+        {
+            std::cout << "ERROR::CAMERA_PATH:: could not read " << path << std::endl;
+            return false;
+        }
+        string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(in, line))
+        {
+            lineNumber++;
+            size_t start = line.find_first_not_of(" \t\r");
+            if (start == string::npos || line[start] == '#')
+                continue;
+            std::istringstream fields(line);
+            CameraKeyframe keyframe;
+            keyframe.zoom = ZOOM;
+            if (!(fields >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+                         >> keyframe.yaw >> keyframe.pitch))
+            {
+                std::cout << "ERROR::CAMERA_PATH:: " << path << ":" << lineNumber << " expected time x y z yaw pitch [zoom]" << std::endl;
+                return false;
+            }
+            fields >> keyframe.zoom;
+            if (!keyframes.empty() && keyframe.time <= keyframes.back().time)
+            {
+                std::cout << "ERROR::CAMERA_PATH:: " << path << ":" << lineNumber << " times have to increase" << std::endl;
+                return false;
+            }
+            keyframes.push_back(keyframe);
+        }
+        if (keyframes.empty())
+        {
+            std::cout << "ERROR::CAMERA_PATH:: " << path << " has no keyframes" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    float Duration() const
+    {
+        return keyframes.empty() ? 0.0f : keyframes.back().time - keyframes.front().time;
+    }
+
+    bool Empty() const { return keyframes.empty(); }
+
+    // the camera at time, the default camera for an empty path
+    CameraKeyframe Sample(float time) const
+    {
+        if (keyframes.empty())
+            return CameraKeyframe{time, glm::vec3(0.0f), YAW, PITCH, ZOOM};
+        if (time <= keyframes.front().time)
+            return keyframes.front();
+        if (time >= keyframes.back().time)
+            return keyframes.back();
+        size_t next = 1;
+        while (keyframes[next].time < time)
+            next++;
+        const CameraKeyframe &a = keyframes[next - 1], &b = keyframes[next];
+        float t = (time - a.time) / (b.time - a.time);
+        CameraKeyframe result;
+        result.time = time;
+        result.position = glm::mix(a.position, b.position, t);
+        result.yaw = glm::mix(a.yaw, b.yaw, t);
+        result.pitch = glm::mix(a.pitch, b.pitch, t);
+        result.zoom = glm::mix(a.zoom, b.zoom, t);
+        return result;
+    }
+
+    // puts the camera where the path is at time, in seconds from the first keyframe. An empty path leaves the camera
+    // alone.
+    void Apply(Camera &camera, float time) const
+    {
+        if (keyframes.empty())
+            return;
+        CameraKeyframe keyframe = Sample(keyframes.front().time + time);
+        camera.Position = keyframe.position;
+        camera.Zoom = keyframe.zoom;
+        camera.SetOrientation(keyframe.yaw, keyframe.pitch);
+    }
+};
+#endif
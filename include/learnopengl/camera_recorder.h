@@ -0,0 +1,204 @@
+#ifndef CAMERA_RECORDER_H
+#define CAMERA_RECORDER_H
+
+#include <learnopengl/camera.h>
+#include <learnopengl/camera_path.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// the input that moved the camera during one frame
+struct CameraInput {
+    uint32_t keys = 0;          // bit (1 << Camera_Movement) per movement key held
+    float mouseX = 0.0f, mouseY = 0.0f;  // cursor offsets, as passed to ProcessMouseMovement
+    float scroll = 0.0f;
+
+    void Press(Camera_Movement movement) { keys |= 1u << movement; }
+    void Clear() { *this = CameraInput(); }
+};
+
+// one recorded frame, 44 bytes in the file
+struct CameraRecordFrame {
+    float time;                 // seconds since the recording started
+    float position[3];
+    float yaw, pitch, zoom;
+    float mouseX, mouseY, scroll;
+    uint32_t keys;
+};
+static_assert(sizeof(CameraRecordFrame) == 44, "CameraRecordFrame is written as is");
+
+// records the camera state and the input of every frame into a compact binary log and plays it back:
+//
+//     "FLCR", uint32 version, uint32 frame count, then the frames as CameraRecordFrame, little endian
+//
+// Playback does not replay the input, which would depend on the frame times of the run. It drives the camera with the
+// recorded state instead, resampled on a fixed timestep: playback frame n always shows the camera at n * PLAYBACK_STEP
+// seconds, so two builds render the same frames no matter how fast they run. The scene animation follows the playback
+// time as well. The input stays in the log to see what the user did at a stutter.
+class CameraRecorder
+{
+public:
+    enum State { IDLE, RECORDING, PLAYING };
+
+    static constexpr float PLAYBACK_STEP = 1.0f / 60.0f;
+    static const uint32_t VERSION = 1;
+
+    CameraRecorder() : state(IDLE), recordStart(0.0f), playbackFrame(0) {}
+
+    State GetState() const { return state; }
+    size_t FrameCount() const { return frames.size(); }
+    float Duration() const { return frames.empty() ? 0.0f : frames.back().time - frames.front().time; }
+    // the next playback frame, 0 until the first one was played
+    unsigned int PlaybackFrame() const { return playbackFrame; }
+
+    void StartRecording(float time)
+    {
+        frames.clear();
+        recordStart = time;
+        state = RECORDING;
+    }
+
+    // call once per frame after the input was applied to the camera, time is the frame's time in seconds
+    void Capture(float time, const Camera &camera, const CameraInput &input)
+    {
+        if (state != RECORDING)
+            return;
+        CameraRecordFrame frame;
+        frame.time = time - recordStart;
+        frame.position[0] = camera.Position.x;
+        frame.position[1] = camera.Position.y;
+        frame.position[2] = camera.Position.z;
+        frame.yaw = camera.Yaw;
+        frame.pitch = camera.Pitch;
+        frame.zoom = camera.Zoom;
+        frame.mouseX = input.mouseX;
+        frame.mouseY = input.mouseY;
+        frame.scroll = input.scroll;
+        frame.keys = input.keys;
+        frames.push_back(frame);
+    }
+
+    // ends the recording and writes it to path
+    bool StopRecording(const string &path)
+    {
+        state = IDLE;
+        return Save(path);
+    }
+
+    bool Save(const string &path) const
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::CAMERA_RECORDER:: could not write " << path << std::endl;
+            return false;
+        }
+        uint32_t version = VERSION, count = frames.size();
+        out.write("FLCR", 4);
+        out.write((const char*)&version, sizeof(version));
+        out.write((const char*)&count, sizeof(count));
+        if (!frames.empty())
+            out.write((const char*)frames.data(), frames.size() * sizeof(CameraRecordFrame));
+        return bool(out);
+    }
+
+    bool Load(const string &path)
+    {
+        state = IDLE;
+        frames.clear();
+        std::ifstream in(path, std::ios::binary);
+        char magic[4] = {};
+        uint32_t version = 0, count = 0;
+        in.read(magic, 4);
+        in.read((char*)&version, sizeof(version));
+        in.read((char*)&count, sizeof(count));
+        if (!in || memcmp(magic, "FLCR", 4) != 0 || version != VERSION)
+        {
+            std::cout << "ERROR::CAMERA_RECORDER:: " << path << " is not a camera recording" << std::endl;
+            return false;
+        }
+        // the count has to match the file before anything is allocated for it
+        std::streamoff header = in.tellg();
+        in.seekg(0, std::ios::end);
+        std::streamoff remaining = in.tellg() - header;
+        in.seekg(header);
+        if (count == 0)
+        {
+            std::cout << "ERROR::CAMERA_RECORDER:: " << path << " has no frames" << std::endl;
+            return false;
+        }
+        if (remaining < 0 || uint64_t(remaining) != uint64_t(count) * sizeof(CameraRecordFrame))
+        {
+            std::cout << "ERROR::CAMERA_RECORDER:: " << path << " has " << count << " frames but "
+                      << remaining << " bytes of frame data" << std::endl;
+            return false;
+        }
+        frames.resize(count);
+        in.read((char*)frames.data(), count * sizeof(CameraRecordFrame));
+        if (!in)
+        {
+            std::cout << "ERROR::CAMERA_RECORDER:: " << path << " is truncated" << std::endl;
+            frames.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // the recorded camera states as a path, frames that share a timestamp keep the first
+    CameraPath Path() const
+    {
+        CameraPath path;
+        for (const CameraRecordFrame &frame : frames)
+        {
+            if (!path.keyframes.empty() && frame.time <= path.keyframes.back().time)
+                continue;
+            path.keyframes.push_back({frame.time, glm::vec3(frame.position[0], frame.position[1], frame.position[2]),
+                                      frame.yaw, frame.pitch, frame.zoom});
+        }
+        return path;
+    }
+
+    // starts from the first frame of the recording, false if there is none
+    bool StartPlayback()
+    {
+        if (frames.empty())
+            return false;
+        path = Path();
+        playbackFrame = 0;
+        state = PLAYING;
+        return true;
+    }
+
+    void StopPlayback()
+    {
+        if (state == PLAYING)
+            state = IDLE;
+    }
+
+    // call once per frame: puts the camera at the next step and returns its time, false when not playing. Playback
+    // stops after the step that reached the end of the recording.
+    bool Playback(Camera &camera, float &time)
+    {
+        if (state != PLAYING)
+            return false;
+        time = playbackFrame * PLAYBACK_STEP;
+        path.Apply(camera, time);
+        playbackFrame++;
+        if (time >= path.Duration())
+            state = IDLE;
+        return true;
+    }
+
+private:
+    State state;
+    vector<CameraRecordFrame> frames;
+    float recordStart;
+    CameraPath path;
+    unsigned int playbackFrame;
+};
+#endif
@@ -0,0 +1,263 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// scoped CPU zones, recorded per thread:
+//
+//     void Model::Finalize() {
+//         PROFILE_ZONE("Model::Finalize");
+//         ...
+//     }
+//
+// A zone is two steady_clock reads and one store into the ring of its thread, no locks. Every thread owns a ring of
+// the last CpuProfileThread::CAPACITY zones; the owner is the only writer, readers (the ImGui view, the trace export)
+// copy the ring and drop the entries the owner may have overwritten meanwhile. Threads register on their first zone,
+// that is the only time the profiler locks.
+//
+// The macros compile to nothing unless CPU_PROFILER_ENABLED is defined (CMake option CPU_PROFILER, off by default for
+// Release builds). Zone names must outlive the profiler, string literals or Intern.
+struct CpuProfileEvent {
+    const char *name;
+    uint64_t begin, end;  // nanoseconds, CpuProfiler::Now
+    uint32_t depth;       // nesting level on its thread, 0 for the outermost zone
+};
+
+class CpuProfileThread
+{
+public:
+    static const uint64_t CAPACITY = 1 << 14;
+
+    CpuProfileThread(uint32_t id, string name) : id(id), name(std::move(name)), depth(0), written(0), events(CAPACITY) {}
+
+    const uint32_t id;
+    string name;          // guarded by the profiler's mutex
+    uint32_t depth;       // owner only
+
+    // owner only
+    void Push(const char *zone, uint64_t begin, uint64_t end, uint32_t zoneDepth)
+    {
+        uint64_t index = written.load(std::memory_order_relaxed);
+        CpuProfileEvent &event = events[index % CAPACITY];
+        event.name = zone;
+        event.begin = begin;
+        event.end = end;
+        event.depth = zoneDepth;
+        written.store(index + 1, std::memory_order_release);
+    }
+
+    // appends the recorded zones that overlap [from, to) to out, oldest first
+    void Copy(uint64_t from, uint64_t to, vector<CpuProfileEvent> &out) const
+    {
+        uint64_t end = written.load(std::memory_order_acquire);
+        uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+        // zones are pushed when they end, so the ring is sorted by end time and the walk back stops at the first zone
+        // that ended before from
+        vector<std::pair<uint64_t, CpuProfileEvent>> found;
+        for (uint64_t i = end; i-- > begin;)
+        {
+            CpuProfileEvent event = events[i % CAPACITY];
+            if (event.end <= from)
+                break;
+            if (event.begin < to)
+                found.push_back(std::make_pair(i, event));
+        }
+        // the owner went on meanwhile, the slots it reused (and the one it is writing) hold other zones now
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = written.load(std::memory_order_relaxed);
+        uint64_t firstValid = after >= CAPACITY ? after - CAPACITY + 1 : 0;
+        for (auto it = found.rbegin(); it != found.rend(); ++it)
+            if (it->first >= firstValid)
+                out.push_back(it->second);
+    }
+
+private:
+    std::atomic<uint64_t> written;
+    vector<CpuProfileEvent> events;
+};
+
+class CpuProfiler
+{
+public:
+    // what a view of the profile gets per thread
+    struct ThreadCapture {
+        uint32_t id;
+        string name;
+        vector<CpuProfileEvent> events;
+    };
+
+    static CpuProfiler &Instance()
+    {
+        static CpuProfiler profiler;
+        return profiler;
+    }
+
+    // nanoseconds since the first call
+    static uint64_t Now()
+    {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // the calling thread's ring, registered on first use
+    static CpuProfileThread &Thread()
+    {
+        thread_local CpuProfileThread *thread = Instance().registerThread();
+        return *thread;
+    }
+
+    // shown instead of "Thread <id>"
+    static void SetThreadName(const string &name)
+    {
+        CpuProfileThread &thread = Thread();
+        std::lock_guard<std::mutex> lock(Instance().mutex);
+        thread.name = name;
+    }
+
+    // a copy of name that lives as long as the program, for zones with computed names
+    static const char *Intern(const string &name)
+    {
+        CpuProfiler &profiler = Instance();
+        std::lock_guard<std::mutex> lock(profiler.mutex);
+        return profiler.names.insert(name).first->c_str();
+    }
+
+    // call at the start of every frame on the main thread
+    void FrameMark()
+    {
+        previousFrame = currentFrame;
+        currentFrame = Now();
+    }
+
+    // the zones of every thread during the last complete frame, [begin, end)
+    vector<ThreadCapture> CaptureLastFrame(uint64_t &begin, uint64_t &end)
+    {
+        begin = previousFrame;
+        end = currentFrame;
+        return capture(begin, end);
+    }
+
+    // writes every recorded zone as Chrome trace events, for chrome://tracing and Perfetto
+    bool WriteChromeTrace(const string &path)
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::CPU_PROFILER:: could not write " << path << std::endl;
+            return false;
+        }
+        vector<ThreadCapture> threads = capture(0, UINT64_MAX);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        char number[64];
+        for (const ThreadCapture &thread : threads)
+        {
+            out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.id
+                << ",\"args\":{\"name\":\"" << escape(thread.name) << "\"}}";
+            first = false;
+            for (const CpuProfileEvent &event : thread.events)
+            {
+                // microseconds with the nanoseconds kept as decimals
+                snprintf(number, sizeof(number), "\"ts\":%.3f,\"dur\":%.3f", event.begin * 1e-3, (event.end - event.begin) * 1e-3);
+                out << ",\n{\"name\":\"" << escape(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.id << ','
+                    << number << '}';
+            }
+        }
+        out << "\n]}\n";
+        return bool(out);
+    }
+
+private:
+    std::mutex mutex;
+    vector<unique_ptr<CpuProfileThread>> threads;
+    std::set<string> names;
+    uint64_t previousFrame = 0, currentFrame = 0;
+
+    CpuProfiler() { Now(); }
+
+    CpuProfileThread *registerThread()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint32_t id = threads.size();
+        threads.emplace_back(new CpuProfileThread(id, "Thread " + std::to_string(id)));
+        return threads.back().get();
+    }
+
+    vector<ThreadCapture> capture(uint64_t from, uint64_t to)
+    {
+        vector<ThreadCapture> result;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &thread : threads)
+        {
+            ThreadCapture captured;
+            captured.id = thread->id;
+            captured.name = thread->name;
+            thread->Copy(from, to, captured.events);
+            result.push_back(std::move(captured));
+        }
+        return result;
+    }
+
+    static string escape(const string &text)
+    {
+        string result;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            if ((unsigned char)c >= 0x20)
+                result += c;
+        }
+        return result;
+    }
+};
+
+class CpuProfileZone
+{
+public:
+    explicit CpuProfileZone(const char *name) : name(name), thread(CpuProfiler::Thread()), begin(CpuProfiler::Now())
+    {
+        depth = thread.depth++;
+    }
+
+    ~CpuProfileZone()
+    {
+        thread.depth--;
+        thread.Push(name, begin, CpuProfiler::Now(), depth);
+    }
+
+    CpuProfileZone(const CpuProfileZone&) = delete;
+    CpuProfileZone& operator=(const CpuProfileZone&) = delete;
+
+private:
+    const char *name;
+    CpuProfileThread &thread;
+    uint64_t begin;
+    uint32_t depth;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#ifdef CPU_PROFILER_ENABLED
+// times the rest of the enclosing block
+#define PROFILE_ZONE(name) CpuProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) CpuProfiler::SetThreadName(name)
+#define PROFILE_FRAME() CpuProfiler::Instance().FrameMark()
+#else
+#define PROFILE_ZONE(name) do {} while (0)
+#define PROFILE_THREAD_NAME(name) do {} while (0)
+#define PROFILE_FRAME() do {} while (0)
+#endif
+#endif
@@ -0,0 +1,48 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <algorithm>
+#include <cmath>
+
+// picks the fraction of the window the scene is rendered at (RenderGraph::SetRenderScale) so the GPU time of a frame
+// approaches a target. The cost of most passes grows with the pixel count, the square of the scale, so the scale
+// that would meet the target is scale * sqrt(target / measured). The measurement comes from GpuTimer queries that
+// lag a few frames behind and are smoothed, so the controller only moves a small step towards it per frame and
+// ignores errors inside a dead band; otherwise it would oscillate.
+class DynamicResolution
+{
+public:
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float targetMilliseconds = 16.0f;
+    // largest change of the scale per frame
+    float maxStep = 0.02f;
+    // relative frame time error that is accepted without a change
+    float deadBand = 0.05f;
+
+    DynamicResolution() : scale(1.0f) {}
+
+    // feeds the GPU time of the latest measured frame, returns the scale for the next one
+    float Update(double gpuMilliseconds)
+    {
+        if (gpuMilliseconds <= 0.0)
+            return scale;
+        double error = (gpuMilliseconds - targetMilliseconds) / targetMilliseconds;
+        if (std::abs(error) > deadBand)
+        {
+            float ideal = scale * float(std::sqrt(targetMilliseconds / gpuMilliseconds));
+            scale += std::min(std::max(ideal - scale, -maxStep), maxStep);
+        }
+        scale = std::min(std::max(scale, minScale), maxScale);
+        return scale;
+    }
+
+    float Scale() const { return scale; }
+
+    // back to full resolution, e.g. when the mode is switched off
+    void Reset() { scale = maxScale; }
+
+private:
+    float scale;
+};
+#endif
@@ -0,0 +1,153 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <string>
+
+// glad was generated for the plain OpenGL 3.3 core profile. The few newer entry points we can make use of are loaded
+// here at runtime; every feature has a flag that tells whether the driver provides it, callers fall back otherwise.
+
+// ARB_texture_storage / GL 4.2
+typedef void (APIENTRYP PFNGLTEXSTORAGE2DPROC_EXT)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+// ARB_get_program_binary / GL 4.1
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC_EXT)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC_EXT)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC_EXT)(GLuint program, GLenum pname, GLint value);
+// KHR_parallel_shader_compile / ARB_parallel_shader_compile
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT)(GLuint count);
+// ARB_pipeline_statistics_query / GL 4.6, plain glBeginQuery targets
+#ifndef GL_PRIMITIVES_SUBMITTED_ARB
+#define GL_PRIMITIVES_SUBMITTED_ARB 0x82EF
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB 0x82F4
+#endif
+
+struct GLExtensions {
+    bool textureStorage = false;
+    PFNGLTEXSTORAGE2DPROC_EXT TexStorage2D = nullptr;
+    // compressed texture formats (RGTC is core since 3.0)
+    bool textureCompressionS3TC = false;
+    bool textureCompressionBPTC = false;
+    // program binaries, only set if the driver also reports at least one binary format
+    bool programBinary = false;
+    PFNGLGETPROGRAMBINARYPROC_EXT GetProgramBinary = nullptr;
+    PFNGLPROGRAMBINARYPROC_EXT ProgramBinary = nullptr;
+    PFNGLPROGRAMPARAMETERIPROC_EXT ProgramParameteri = nullptr;
+    // GL_COMPLETION_STATUS_KHR can be queried without waiting for the compiler
+    bool parallelShaderCompile = false;
+    PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT MaxShaderCompilerThreads = nullptr;
+    bool pipelineStatistics = false;
+};
+
+inline GLExtensions &GLExt()
+{
+    static GLExtensions extensions;
+    return extensions;
+}
+
+inline bool HasGLExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+inline bool HasGLVersion(int major, int minor)
+{
+    GLint contextMajor = 0, contextMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+    return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+// call once after gladLoadGLLoader with the same loader
+inline void LoadGLExtensions(GLADloadproc load)
+{
+    GLExtensions &ext = GLExt();
+    if (HasGLVersion(4, 2) || HasGLExtension("GL_ARB_texture_storage"))
+    {
+        ext.TexStorage2D = (PFNGLTEXSTORAGE2DPROC_EXT)load("glTexStorage2D");
+        ext.textureStorage = ext.TexStorage2D != nullptr;
+    }
+    ext.textureCompressionS3TC = HasGLExtension("GL_EXT_texture_compression_s3tc");
+    ext.textureCompressionBPTC = HasGLVersion(4, 2) || HasGLExtension("GL_ARB_texture_compression_bptc");
+    if (HasGLVersion(4, 1) || HasGLExtension("GL_ARB_get_program_binary"))
+    {
+        ext.GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC_EXT)load("glGetProgramBinary");
+        ext.ProgramBinary = (PFNGLPROGRAMBINARYPROC_EXT)load("glProgramBinary");
+        ext.ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC_EXT)load("glProgramParameteri");
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        ext.programBinary = ext.GetProgramBinary && ext.ProgramBinary && ext.ProgramParameteri && formats > 0;
+    }
+    if (HasGLExtension("GL_KHR_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT)load("glMaxShaderCompilerThreadsKHR");
+    else if (HasGLExtension("GL_ARB_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT)load("glMaxShaderCompilerThreadsARB");
+    if (ext.MaxShaderCompilerThreads)
+    {
+        // let the driver use as many compiler threads as it likes
+        ext.MaxShaderCompilerThreads(0xFFFFFFFF);
+        ext.parallelShaderCompile = true;
+    }
+    ext.pipelineStatistics = HasGLVersion(4, 6) || HasGLExtension("GL_ARB_pipeline_statistics_query");
+}
+
+// immutable-style storage for a complete mip chain. Uses glTexStorage2D when available, otherwise every level is
+// specified up front with the sized format and the level range is fixed, which gives the driver the same information.
+inline void AllocateTextureStorage(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height)
+{
+    if (GLExt().textureStorage)
+    {
+        GLExt().TexStorage2D(target, levels, internalFormat, width, height);
+        return;
+    }
+    // the format/type pair only has to be valid for the sized format, no data is transferred
+    GLenum format = internalFormat == GL_R8 ? GL_RED : internalFormat == GL_RG8 ? GL_RG : internalFormat == GL_RGB8 ? GL_RGB : GL_RGBA;
+    for (GLsizei level = 0; level < levels; level++)
+    {
+        GLsizei w = width >> level > 0 ? width >> level : 1;
+        GLsizei h = height >> level > 0 ? height >> level : 1;
+        if (target == GL_TEXTURE_CUBE_MAP)
+        {
+            for (unsigned int face = 0; face < 6; face++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, internalFormat, w, h, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        }
+        else
+        {
+            glTexImage2D(target, level, internalFormat, w, h, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+    glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+// number of levels of a full mip chain
+inline GLsizei MipLevelCount(GLsizei width, GLsizei height)
+{
+    GLsizei levels = 1;
+    GLsizei size = width > height ? width : height;
+    while (size > 1)
+    {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+#endif
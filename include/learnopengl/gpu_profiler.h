@@ -0,0 +1,112 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <learnopengl/gpu_timer.h>
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+// owns the GpuTimers of the frame, in the order they are shown, and logs their results to a CSV file on request.
+// One row is written per frame, with the results that arrived in that frame; those were measured GpuTimer::LATENCY
+// frames earlier. A timer whose pass did not run leaves its columns empty.
+//
+//   frame,cpu_ms,<timer>_ms[,<timer>_primitives,<timer>_fragments],...
+class GpuProfiler
+{
+public:
+    GpuProfiler() : frame(0) {}
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // a new timer, valid until Delete
+    GpuTimer &Timer(const string &name, bool statistics = false)
+    {
+        timers.emplace_back(new GpuTimer(name, statistics));
+        return *timers.back();
+    }
+
+    size_t TimerCount() const { return timers.size(); }
+    const GpuTimer &TimerAt(size_t index) const { return *timers[index]; }
+
+    bool StartCsv(const string &path)
+    {
+        csv.close();
+        csv.clear();
+        csv.open(path, std::ios::trunc);
+        if (!csv)
+        {
+            std::cout << "ERROR::GPU_PROFILER:: could not write " << path << std::endl;
+            return false;
+        }
+        csvPath = path;
+        // rows count from 1 in every file
+        frame = 0;
+        csv << "frame,cpu_ms";
+        for (const auto &timer : timers)
+        {
+            csv << ',' << timer->name << "_ms";
+            if (timer->HasStatistics())
+                csv << ',' << timer->name << "_primitives," << timer->name << "_fragments";
+        }
+        csv << '\n';
+        return true;
+    }
+
+    void StopCsv()
+    {
+        csv.close();
+    }
+
+    bool Recording() const { return csv.is_open(); }
+    const string &CsvPath() const { return csvPath; }
+
+    // call once per frame after every timer of the frame ran
+    void EndFrame(double cpuMilliseconds)
+    {
+        frame++;
+        bool recording = Recording();
+        if (recording)
+            csv << frame << ',' << cpuMilliseconds;
+        for (auto &timer : timers)
+        {
+            // taken in any case, so a recording started later doesn't pick up old results
+            bool collected = timer->TakeCollected();
+            if (!recording)
+                continue;
+            csv << ',';
+            if (collected)
+                csv << timer->LatestMilliseconds();
+            if (timer->HasStatistics())
+            {
+                csv << ',';
+                if (collected)
+                    csv << timer->LatestPrimitives();
+                csv << ',';
+                if (collected)
+                    csv << timer->LatestFragmentInvocations();
+            }
+        }
+        if (recording)
+            csv << '\n';
+    }
+
+    void Delete()
+    {
+        StopCsv();
+        for (auto &timer : timers)
+            timer->Delete();
+        timers.clear();
+    }
+
+private:
+    vector<unique_ptr<GpuTimer>> timers;
+    std::ofstream csv;
+    string csvPath;
+    unsigned long frame;
+};
+#endif
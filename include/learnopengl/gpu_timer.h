@@ -0,0 +1,167 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_ext.h>
+
+#include <string>
+
+// measures the GPU time of the commands between Begin and End with a pair of GL_TIMESTAMP queries. Results are read
+// LATENCY frames later when they are available anyway, so timing never stalls the pipeline. Timestamps nest, a timer
+// may run inside another one (e.g. a pass inside the frame).
+//
+// With statistics the timer also counts the primitives submitted and the fragment shader invocations between Begin
+// and End, if the driver has ARB_pipeline_statistics_query. Those queries do not nest, only one timer with statistics
+// can run at a time.
+// Like the other GL objects the queries are deleted explicitly (Delete) while the context is current.
+class GpuTimer
+{
+public:
+    static const unsigned int LATENCY = 4;
+
+    std::string name;
+
+    explicit GpuTimer(std::string name, bool statistics = false)
+        : name(std::move(name)), statistics(statistics && GLExt().pipelineStatistics), frame(0), average(0.0),
+          averagePrimitives(0.0), averageFragments(0.0), latest(0.0), latestPrimitives(0), latestFragments(0),
+          measured(false), collected(false), results(0)
+    {
+        glGenQueries(2 * LATENCY, timestamps);
+        if (this->statistics)
+        {
+            glGenQueries(LATENCY, primitives);
+            glGenQueries(LATENCY, fragments);
+        }
+        for (unsigned int i = 0; i < LATENCY; i++)
+            pending[i] = false;
+    }
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void Begin()
+    {
+        unsigned int slot = frame % LATENCY;
+        // collect the measurement this slot made LATENCY frames ago
+        if (pending[slot])
+        {
+            collect(slot);
+            pending[slot] = false;
+        }
+        glQueryCounter(timestamps[2 * slot], GL_TIMESTAMP);
+        if (statistics)
+        {
+            glBeginQuery(GL_PRIMITIVES_SUBMITTED_ARB, primitives[slot]);
+            glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, fragments[slot]);
+        }
+    }
+
+    void End()
+    {
+        unsigned int slot = frame % LATENCY;
+        if (statistics)
+        {
+            glEndQuery(GL_PRIMITIVES_SUBMITTED_ARB);
+            glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+        }
+        glQueryCounter(timestamps[2 * slot + 1], GL_TIMESTAMP);
+        pending[slot] = true;
+        frame++;
+    }
+
+    // smoothed GPU time in milliseconds, 0 until the first result arrived
+    double Milliseconds() const { return average; }
+    // smoothed counts, 0 without statistics
+    double Primitives() const { return averagePrimitives; }
+    double FragmentInvocations() const { return averageFragments; }
+    bool HasStatistics() const { return statistics; }
+
+    // the result that arrived in the latest Begin, unsmoothed. TakeCollected tells whether there was one since the
+    // last call.
+    double LatestMilliseconds() const { return latest; }
+    GLuint64 LatestPrimitives() const { return latestPrimitives; }
+    GLuint64 LatestFragmentInvocations() const { return latestFragments; }
+    bool TakeCollected()
+    {
+        bool result = collected;
+        collected = false;
+        return result;
+    }
+    // results collected so far, a reader that doesn't own TakeCollected watches this for new ones
+    unsigned long ResultCount() const { return results; }
+
+    void Delete()
+    {
+        glDeleteQueries(2 * LATENCY, timestamps);
+        if (statistics)
+        {
+            glDeleteQueries(LATENCY, primitives);
+            glDeleteQueries(LATENCY, fragments);
+        }
+    }
+
+private:
+    GLuint timestamps[2 * LATENCY];
+    GLuint primitives[LATENCY];
+    GLuint fragments[LATENCY];
+    bool pending[LATENCY];
+    bool statistics;
+    unsigned int frame;
+    double average, averagePrimitives, averageFragments;
+    double latest;
+    GLuint64 latestPrimitives, latestFragments;
+    bool measured;
+    bool collected;
+    unsigned long results;
+
+    void collect(unsigned int slot)
+    {
+        // a result that is still missing is dropped, waiting for it would stall
+        GLint available = 0;
+        glGetQueryObjectiv(timestamps[2 * slot + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available && statistics)
+        {
+            glGetQueryObjectiv(primitives[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+                glGetQueryObjectiv(fragments[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        }
+        if (!available)
+            return;
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(timestamps[2 * slot], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(timestamps[2 * slot + 1], GL_QUERY_RESULT, &end);
+        latest = end > begin ? (end - begin) * 1e-6 : 0.0;
+        if (statistics)
+        {
+            glGetQueryObjectui64v(primitives[slot], GL_QUERY_RESULT, &latestPrimitives);
+            glGetQueryObjectui64v(fragments[slot], GL_QUERY_RESULT, &latestFragments);
+        }
+        average = smooth(average, latest);
+        averagePrimitives = smooth(averagePrimitives, double(latestPrimitives));
+        averageFragments = smooth(averageFragments, double(latestFragments));
+        measured = true;
+        collected = true;
+        results++;
+    }
+
+    double smooth(double average, double value) const
+    {
+        return measured ? average + (value - average) * 0.1 : value;
+    }
+};
+
+// times the rest of the enclosing block
+class GpuTimerScope
+{
+public:
+    explicit GpuTimerScope(GpuTimer &timer) : timer(timer) { timer.Begin(); }
+    ~GpuTimerScope() { timer.End(); }
+
+    GpuTimerScope(const GpuTimerScope&) = delete;
+    GpuTimerScope& operator=(const GpuTimerScope&) = delete;
+
+private:
+    GpuTimer &timer;
+};
+#endif
@@ -0,0 +1,218 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+
+#ifdef HEADLESS_BENCHMARK_ENABLED
+// only the EGL API, not the X11 types that eglplatform.h would pull in otherwise
+#ifndef EGL_NO_X11
+#define EGL_NO_X11
+#endif
+#ifndef MESA_EGL_NO_X11_HEADERS
+#define MESA_EGL_NO_X11_HEADERS
+#endif
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+// an OpenGL 3.3 core context without a window, for the benchmark on machines without a display. It runs on any EGL
+// driver, Mesa's llvmpipe included, so CI boxes without a GPU work too. The surfaceless platform (EGL_MESA_platform_
+// surfaceless) is used when the driver has it, the default display otherwise. The frame goes into an offscreen
+// framebuffer (Framebuffer) that stands in for the window's, Present stands in for the buffer swap.
+//
+//     HeadlessContext context;
+//     context.Create();
+//     gladLoadGLLoader((GLADloadproc) HeadlessContext::GetProcAddress);
+//     context.CreateFramebuffer(width, height);
+//     ... render into context.Framebuffer(), context.Present() per frame ...
+//     context.Delete();
+//
+// Without EGL (CMake option HEADLESS_BENCHMARK off, or EGL not found) Create only reports that the benchmark was not
+// built in.
+class HeadlessContext
+{
+public:
+    // frames the CPU may run ahead of the GPU, like a double buffered swap chain
+    static const unsigned int FRAMES_IN_FLIGHT = 2;
+
+    HeadlessContext() : display(EGL_NO_DISPLAY), surface(EGL_NO_SURFACE), context(EGL_NO_CONTEXT), framebuffer(0),
+                        colorbuffer(0), depthbuffer(0), frame(0)
+    {
+        for (unsigned int i = 0; i < FRAMES_IN_FLIGHT; i++)
+            fences[i] = 0;
+    }
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // creates the context and makes it current, prints what failed otherwise
+    bool Create()
+    {
+        const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+                (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint major = 0, minor = 0;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+            return fail("no EGL display");
+        if (!eglBindAPI(EGL_OPENGL_API))
+            return fail("EGL can't create desktop OpenGL contexts");
+
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+            return fail("no EGL config for OpenGL");
+
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+            EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT)
+            return fail("could not create an OpenGL 3.3 core context");
+
+        // everything is rendered into the offscreen framebuffer, a surface is only made for drivers that need one to
+        // make the context current
+        if (!hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+        {
+            const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+            surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+        }
+        if (!eglMakeCurrent(display, surface, surface, context))
+            return fail("could not make the context current");
+        return true;
+    }
+
+    // loader for gladLoadGLLoader and LoadGLExtensions
+    static void *GetProcAddress(const char *name)
+    {
+        return (void*)eglGetProcAddress(name);
+    }
+
+    // the stand-in for the window's framebuffer, call after glad is loaded
+    void CreateFramebuffer(int width, int height)
+    {
+        glGenRenderbuffers(1, &colorbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        // the window's framebuffer has a depth buffer as well, ImGui and the passes may rely on it
+        glGenRenderbuffers(1, &depthbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorbuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthbuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::HEADLESS_CONTEXT:: Framebuffer not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    unsigned int Framebuffer() const { return framebuffer; }
+
+    // ends the frame: the CPU waits until the GPU finished the frame FRAMES_IN_FLIGHT frames back, a swap chain
+    // would throttle the same way. Without it the driver queues as many frames as the CPU manages to submit.
+    void Present()
+    {
+        unsigned int slot = frame % FRAMES_IN_FLIGHT;
+        if (fences[slot])
+        {
+            while (glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED)
+                ;
+            glDeleteSync(fences[slot]);
+        }
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        frame++;
+    }
+
+    // releases the framebuffer and the context
+    void Delete()
+    {
+        // GL objects only exist once glad was loaded and CreateFramebuffer ran
+        if (framebuffer)
+        {
+            glFinish();
+            for (unsigned int i = 0; i < FRAMES_IN_FLIGHT; i++)
+                if (fences[i])
+                    glDeleteSync(fences[i]);
+            glDeleteFramebuffers(1, &framebuffer);
+            glDeleteRenderbuffers(1, &colorbuffer);
+            glDeleteRenderbuffers(1, &depthbuffer);
+            framebuffer = 0;
+        }
+        if (context != EGL_NO_CONTEXT)
+        {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(display, context);
+            context = EGL_NO_CONTEXT;
+        }
+        if (surface != EGL_NO_SURFACE)
+        {
+            eglDestroySurface(display, surface);
+            surface = EGL_NO_SURFACE;
+        }
+        if (display != EGL_NO_DISPLAY)
+        {
+            eglTerminate(display);
+            display = EGL_NO_DISPLAY;
+        }
+    }
+
+private:
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+    unsigned int framebuffer, colorbuffer, depthbuffer;
+    GLsync fences[FRAMES_IN_FLIGHT];
+    unsigned long frame;
+
+    static bool hasExtension(const char *extensions, const char *name)
+    {
+        if (!extensions)
+            return false;
+        size_t length = strlen(name);
+        for (const char *found = strstr(extensions, name); found; found = strstr(found + length, name))
+            if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+                return true;
+        return false;
+    }
+
+    bool fail(const char *what)
+    {
+        std::cout << "ERROR::HEADLESS_CONTEXT:: " << what << " (EGL error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        Delete();
+        return false;
+    }
+};
+#else
+class HeadlessContext
+{
+public:
+    bool Create()
+    {
+        std::cout << "ERROR::HEADLESS_CONTEXT:: built without EGL, configure with -DHEADLESS_BENCHMARK=ON" << std::endl;
+        return false;
+    }
+
+    static void *GetProcAddress(const char *name) { return nullptr; }
+    void CreateFramebuffer(int width, int height) {}
+    unsigned int Framebuffer() const { return 0; }
+    void Present() {}
+    void Delete() {}
+};
+#endif
+#endif
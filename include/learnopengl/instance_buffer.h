@@ -0,0 +1,65 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+using namespace std;
+
+// per-instance model matrices for instanced draws. The matrix is read as a vertex attribute that advances once per
+// instance and occupies four consecutive locations, one per column:
+//
+//     layout (location = 5) in mat4 aInstanceModel;   // locations 5, 6, 7 and 8
+//
+// Like the other GL objects the buffer is deleted explicitly (glDeleteBuffers on ID) while the context is current.
+class InstanceBuffer
+{
+public:
+    static const GLuint MATRIX_LOCATION = 5;
+
+    unsigned int ID;
+
+    InstanceBuffer() : ID(0), count(0)
+    {
+        glGenBuffers(1, &ID);
+    }
+
+    explicit InstanceBuffer(const vector<glm::mat4> &matrices) : InstanceBuffer()
+    {
+        Update(matrices);
+    }
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    // replaces the matrices. The old storage is orphaned, so instances can be updated every frame without waiting
+    // for draws that still read the previous contents.
+    void Update(const vector<glm::mat4> &matrices)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, ID);
+        glBufferData(GL_ARRAY_BUFFER, matrices.size() * sizeof(glm::mat4), matrices.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        count = matrices.size();
+    }
+
+    unsigned int Count() const { return count; }
+
+    // points the instance attributes of the currently bound VAO at this buffer
+    void Attach() const
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, ID);
+        for (GLuint column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(MATRIX_LOCATION + column);
+            glVertexAttribPointer(MATRIX_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(MATRIX_LOCATION + column, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+private:
+    unsigned int count;
+};
+#endif
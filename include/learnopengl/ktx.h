@@ -0,0 +1,131 @@
+#ifndef KTX_H
+#define KTX_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// compressed formats that are not part of the GL 3.3 core headers glad provides
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+// Minimal KTX 1.1 container for a single 2D texture with a precomputed mip chain of compressed blocks.
+// https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html
+struct KtxTexture {
+    GLenum internalFormat = 0;
+    GLenum baseInternalFormat = 0;
+    int width = 0;
+    int height = 0;
+    vector<vector<unsigned char>> levels;
+};
+
+namespace ktx {
+
+const unsigned char IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+const uint32_t ENDIANNESS = 0x04030201;
+
+struct Header {
+    unsigned char identifier[12];
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+}
+
+inline bool WriteKtx(const string &path, const KtxTexture &texture)
+{
+    ktx::Header header;
+    memcpy(header.identifier, ktx::IDENTIFIER, 12);
+    header.endianness = ktx::ENDIANNESS;
+    // compressed data: type and format are 0, type size is 1
+    header.glType = 0;
+    header.glTypeSize = 1;
+    header.glFormat = 0;
+    header.glInternalFormat = texture.internalFormat;
+    header.glBaseInternalFormat = texture.baseInternalFormat;
+    header.pixelWidth = texture.width;
+    header.pixelHeight = texture.height;
+    header.pixelDepth = 0;
+    header.numberOfArrayElements = 0;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = texture.levels.size();
+    header.bytesOfKeyValueData = 0;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const char padding[4] = {0, 0, 0, 0};
+    for (const vector<unsigned char> &level : texture.levels)
+    {
+        uint32_t imageSize = level.size();
+        out.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+        out.write(reinterpret_cast<const char*>(level.data()), level.size());
+        out.write(padding, (4 - level.size() % 4) % 4);
+    }
+    return bool(out);
+}
+
+inline bool ReadKtx(const string &path, KtxTexture &texture)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    ktx::Header header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    // only little endian, single face, non-array 2D files as written by WriteKtx are supported
+    if (memcmp(header.identifier, ktx::IDENTIFIER, 12) != 0 || header.endianness != ktx::ENDIANNESS ||
+        header.glType != 0 || header.pixelDepth != 0 || header.numberOfArrayElements != 0 || header.numberOfFaces != 1)
+        return false;
+    in.seekg(header.bytesOfKeyValueData, std::ios::cur);
+
+    texture.internalFormat = header.glInternalFormat;
+    texture.baseInternalFormat = header.glBaseInternalFormat;
+    texture.width = header.pixelWidth;
+    texture.height = header.pixelHeight;
+    texture.levels.clear();
+    uint32_t levelCount = header.numberOfMipmapLevels ? header.numberOfMipmapLevels : 1;
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        uint32_t imageSize;
+        if (!in.read(reinterpret_cast<char*>(&imageSize), sizeof(imageSize)))
+            return false;
+        vector<unsigned char> data(imageSize);
+        if (!in.read(reinterpret_cast<char*>(data.data()), imageSize))
+            return false;
+        in.seekg((4 - imageSize % 4) % 4, std::ios::cur);
+        texture.levels.push_back(std::move(data));
+    }
+    return true;
+}
+
+// path of the cooked version of a source image
+inline string CookedTexturePath(const string &sourcePath)
+{
+    return sourcePath + ".ktx";
+}
+#endif
@@ -0,0 +1,277 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <learnopengl/light_manager.h>
+#include <learnopengl/cpu_profiler.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define LIGHT_CLUSTERS_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// clustered forward shading. The view frustum is split into CLUSTERS_X * CLUSTERS_Y screen tiles and CLUSTERS_Z
+// depth slices that grow exponentially with distance. Every frame the bounding spheres of the point and spot lights
+// (LightManager::Bounds) are tested against the view-space bounds of the clusters they can reach, the result is a
+// list of light indices per cluster:
+//
+//     uniform usamplerBuffer clusterGrid;      // offset, count into clusterLights per cluster
+//     uniform usamplerBuffer clusterLights;    // indices into the LightManager light list
+//
+// Fragments find their cluster from gl_FragCoord and their view depth and only shade the lights listed there, the
+// directional lights are shaded everywhere. Like the other GL objects the buffers and textures are deleted explicitly
+// (Delete) while the context is current.
+class LightClusters
+{
+public:
+    // the counts are repeated as CLUSTER_COUNT in resources/shaders/include/lights.glsl
+    static const unsigned int CLUSTERS_X = 16;
+    static const unsigned int CLUSTERS_Y = 9;
+    static const unsigned int CLUSTERS_Z = 24;
+    static const unsigned int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+    static const GLuint GRID_TEXTURE_UNIT = 13;
+    static const GLuint LIGHTS_TEXTURE_UNIT = 14;
+
+    unsigned int gridBuffer, gridTexture;
+    unsigned int lightsBuffer, lightsTexture;
+
+    LightClusters() : fovY(0.0f), aspect(0.0f), zNear(0.0f), zFar(0.0f), width(1.0f), height(1.0f), maxLights(0),
+                      grid(CLUSTER_COUNT * 2, 0)
+    {
+        glGenBuffers(1, &gridBuffer);
+        glGenTextures(1, &gridTexture);
+        glGenBuffers(1, &lightsBuffer);
+        glGenTextures(1, &lightsTexture);
+        glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, grid.size() * sizeof(uint32_t), grid.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, lightsBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, gridBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, lightsTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, lightsBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    LightClusters(const LightClusters&) = delete;
+    LightClusters& operator=(const LightClusters&) = delete;
+
+    // assigns the lights of the manager (after its Upload) to the clusters of a perspective projection with the given
+    // vertical field of view (radians) and uploads the lists. width and height are the size of the render target in
+    // pixels.
+    void Update(const glm::mat4 &view, float fovY, float aspect, float zNear, float zFar, float width, float height,
+                const LightManager &lightManager)
+    {
+        PROFILE_ZONE("LightClusters::Update");
+        if (fovY != this->fovY || aspect != this->aspect || zNear != this->zNear || zFar != this->zFar)
+        {
+            this->fovY = fovY;
+            this->aspect = aspect;
+            this->zNear = zNear;
+            this->zFar = zFar;
+            buildBounds();
+        }
+        this->width = width;
+        this->height = height;
+
+        const vector<glm::vec4> &bounds = lightManager.Bounds();
+        uint32_t firstIndex = lightManager.directionalLights.size();
+        hits.clear();
+        float logDepthScale = CLUSTERS_Z / log(zFar / zNear);
+        for (size_t i = 0; i < bounds.size(); i++)
+        {
+            glm::vec4 center = view * glm::vec4(glm::vec3(bounds[i]), 1.0f);
+            float radius = bounds[i].w;
+            float depth = -center.z;
+            if (radius <= 0.0f || depth + radius < zNear || depth - radius > zFar)
+                continue;
+            unsigned int firstSlice = slice(depth - radius, logDepthScale);
+            unsigned int lastSlice = slice(depth + radius, logDepthScale);
+            for (unsigned int z = firstSlice; z <= lastSlice; z++)
+                assign(z, glm::vec3(center), radius, firstIndex + i);
+        }
+
+        // counting sort of the (cluster, light) pairs into one index list, lights stay in ascending order per cluster
+        fill(grid.begin(), grid.end(), 0);
+        for (const Hit &hit : hits)
+            grid[hit.cluster * 2 + 1]++;
+        uint32_t offset = 0;
+        maxLights = 0;
+        for (unsigned int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+        {
+            grid[cluster * 2] = offset;
+            offset += grid[cluster * 2 + 1];
+            maxLights = max(maxLights, grid[cluster * 2 + 1]);
+        }
+        indices.resize(max<size_t>(hits.size(), 1));
+        for (const Hit &hit : hits)
+        {
+            uint32_t &cursor = grid[hit.cluster * 2];
+            indices[cursor++] = hit.light;
+        }
+        // the cursors ended at the next cluster's offset, step them back
+        for (unsigned int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+            grid[cluster * 2] -= grid[cluster * 2 + 1];
+
+        glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, grid.size() * sizeof(uint32_t), grid.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, lightsBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // binds the cluster textures and sets the lookup uniforms of the bound program (use)
+    void Bind(const Shader &shader, bool heatmap = false) const
+    {
+        static constexpr UniformHandle<int> CLUSTER_GRID("clusterGrid");
+        static constexpr UniformHandle<int> CLUSTER_LIGHTS("clusterLights");
+        static constexpr UniformHandle<glm::vec2> CLUSTER_SCALE("clusterScale");
+        static constexpr UniformHandle<glm::vec2> CLUSTER_DEPTH("clusterDepth");
+        static constexpr UniformHandle<int> CLUSTER_HEATMAP("clusterHeatmap");
+        glActiveTexture(GL_TEXTURE0 + GRID_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+        glActiveTexture(GL_TEXTURE0 + LIGHTS_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, lightsTexture);
+        glActiveTexture(GL_TEXTURE0);
+        shader.set(CLUSTER_GRID, int(GRID_TEXTURE_UNIT));
+        shader.set(CLUSTER_LIGHTS, int(LIGHTS_TEXTURE_UNIT));
+        // tiles per pixel, depth slices as log(depth) * x + y
+        shader.set(CLUSTER_SCALE, glm::vec2(CLUSTERS_X / width, CLUSTERS_Y / height));
+        float logDepthScale = CLUSTERS_Z / log(zFar / zNear);
+        shader.set(CLUSTER_DEPTH, glm::vec2(logDepthScale, -log(zNear) * logDepthScale));
+        shader.set(CLUSTER_HEATMAP, int(heatmap));
+    }
+
+    // largest number of lights in one cluster during the last Update
+    unsigned int MaxLightsPerCluster() const { return maxLights; }
+    // number of (cluster, light) pairs during the last Update
+    size_t Assignments() const { return hits.size(); }
+
+    void Delete()
+    {
+        glDeleteTextures(1, &gridTexture);
+        glDeleteTextures(1, &lightsTexture);
+        glDeleteBuffers(1, &gridBuffer);
+        glDeleteBuffers(1, &lightsBuffer);
+    }
+
+private:
+    struct Hit {
+        uint32_t cluster;
+        uint32_t light;
+    };
+
+    // tiles of one slice rounded up to whole SSE lanes
+    static const unsigned int SLICE_STRIDE = (CLUSTERS_X * CLUSTERS_Y + 3) & ~3u;
+
+    float fovY, aspect, zNear, zFar;
+    float width, height;
+    uint32_t maxLights;
+    // view-space bounds of every cluster, structure of arrays per slice so four tiles are tested at once
+    vector<float> minX, maxX, minY, maxY;
+    vector<float> minZ, maxZ;
+    vector<Hit> hits;
+    vector<uint32_t> grid;
+    vector<uint32_t> indices;
+
+    unsigned int slice(float depth, float logDepthScale) const
+    {
+        if (depth <= zNear)
+            return 0;
+        int z = int(log(depth / zNear) * logDepthScale);
+        return (unsigned int)min(max(z, 0), int(CLUSTERS_Z) - 1);
+    }
+
+    void buildBounds()
+    {
+        minX.assign(SLICE_STRIDE * CLUSTERS_Z, 0.0f);
+        maxX.assign(SLICE_STRIDE * CLUSTERS_Z, 0.0f);
+        minY.assign(SLICE_STRIDE * CLUSTERS_Z, 0.0f);
+        maxY.assign(SLICE_STRIDE * CLUSTERS_Z, 0.0f);
+        minZ.resize(CLUSTERS_Z);
+        maxZ.resize(CLUSTERS_Z);
+        float tanY = tan(fovY * 0.5f);
+        float tanX = tanY * aspect;
+        for (unsigned int z = 0; z < CLUSTERS_Z; z++)
+        {
+            float sliceNear = zNear * pow(zFar / zNear, float(z) / CLUSTERS_Z);
+            float sliceFar = zNear * pow(zFar / zNear, float(z + 1) / CLUSTERS_Z);
+            // view space looks down -z
+            minZ[z] = -sliceFar;
+            maxZ[z] = -sliceNear;
+            for (unsigned int y = 0; y < CLUSTERS_Y; y++)
+            {
+                float ndcY0 = -1.0f + 2.0f * y / CLUSTERS_Y;
+                float ndcY1 = -1.0f + 2.0f * (y + 1) / CLUSTERS_Y;
+                for (unsigned int x = 0; x < CLUSTERS_X; x++)
+                {
+                    float ndcX0 = -1.0f + 2.0f * x / CLUSTERS_X;
+                    float ndcX1 = -1.0f + 2.0f * (x + 1) / CLUSTERS_X;
+                    // the tile is a frustum segment, its box spans the corners on both depth planes
+                    unsigned int i = z * SLICE_STRIDE + y * CLUSTERS_X + x;
+                    minX[i] = min(ndcX0 * tanX * sliceNear, ndcX0 * tanX * sliceFar);
+                    maxX[i] = max(ndcX1 * tanX * sliceNear, ndcX1 * tanX * sliceFar);
+                    minY[i] = min(ndcY0 * tanY * sliceNear, ndcY0 * tanY * sliceFar);
+                    maxY[i] = max(ndcY1 * tanY * sliceNear, ndcY1 * tanY * sliceFar);
+                }
+            }
+            // padding lanes get an empty box far away so they never intersect
+            for (unsigned int i = CLUSTERS_X * CLUSTERS_Y; i < SLICE_STRIDE; i++)
+            {
+                minX[z * SLICE_STRIDE + i] = minY[z * SLICE_STRIDE + i] = FLT_MAX;
+                maxX[z * SLICE_STRIDE + i] = maxY[z * SLICE_STRIDE + i] = FLT_MAX;
+            }
+        }
+    }
+
+    // sphere against the boxes of all tiles of slice z
+    void assign(unsigned int z, const glm::vec3 &center, float radius, uint32_t light)
+    {
+        // the depth term is the same for the whole slice
+        float dz = max(max(minZ[z] - center.z, center.z - maxZ[z]), 0.0f);
+        float remaining = radius * radius - dz * dz;
+        if (remaining < 0.0f)
+            return;
+        const unsigned int base = z * SLICE_STRIDE;
+        const uint32_t firstCluster = z * CLUSTERS_X * CLUSTERS_Y;
+#ifdef LIGHT_CLUSTERS_SSE
+        const __m128 cx = _mm_set1_ps(center.x);
+        const __m128 cy = _mm_set1_ps(center.y);
+        const __m128 r2 = _mm_set1_ps(remaining);
+        const __m128 zero = _mm_setzero_ps();
+        for (unsigned int i = 0; i < SLICE_STRIDE; i += 4)
+        {
+            __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minX[base + i]), cx),
+                                              _mm_sub_ps(cx, _mm_loadu_ps(&maxX[base + i]))), zero);
+            __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minY[base + i]), cy),
+                                              _mm_sub_ps(cy, _mm_loadu_ps(&maxY[base + i]))), zero);
+            __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            int mask = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+            for (unsigned int lane = 0; mask; lane++, mask >>= 1)
+                if (mask & 1)
+                    hits.push_back(Hit{firstCluster + i + lane, light});
+        }
+#else
+        for (unsigned int i = 0; i < CLUSTERS_X * CLUSTERS_Y; i++)
+        {
+            float dx = max(max(minX[base + i] - center.x, center.x - maxX[base + i]), 0.0f);
+            float dy = max(max(minY[base + i] - center.y, center.y - maxY[base + i]), 0.0f);
+            if (dx * dx + dy * dy <= remaining)
+                hits.push_back(Hit{firstCluster + i, light});
+        }
+#endif
+    }
+};
+#endif
@@ -0,0 +1,228 @@
+#ifndef LIGHT_MANAGER_H
+#define LIGHT_MANAGER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+struct PointLight {
+    glm::vec3 position;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+struct DirLight {
+    glm::vec3 direction;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+};
+
+struct SpotLight{
+    glm::vec3 position;
+    glm::vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+};
+
+// light type stored in the w component of the first texel, matches the LIGHT_* constants in
+// resources/shaders/include/lights.glsl
+enum LightType {
+    LIGHT_DIRECTIONAL = 0,
+    LIGHT_POINT = 1,
+    LIGHT_SPOT = 2
+};
+
+// owns every light of the scene and packs them into a buffer texture that the shaders walk in a single loop:
+//
+//     uniform samplerBuffer lights;    // LIGHT_TEXELS RGBA32F texels per light
+//     uniform int directionalLightCount;
+//
+// Directional lights come first, then point and spot lights, so a program that only wants the sun reads the first
+// directionalLightCount entries. Texels of one light:
+//
+//     0: position.xyz, type     1: direction.xyz, radius     2: ambient.rgb, constant
+//     3: diffuse.rgb, linear    4: specular.rgb, quadratic   5: cutOff, outerCutOff, -, -
+//
+// The light vectors can be edited freely, Upload repacks them and sends the changed range only. Like the other GL
+// objects the buffer and texture are deleted explicitly (Delete) while the context is current.
+class LightManager
+{
+public:
+    static const GLuint TEXTURE_UNIT = 15;
+    static const unsigned int LIGHT_TEXELS = 6;
+    // a light ends where its attenuated contribution drops below one step of an 8 bit channel
+    static constexpr float RADIUS_THRESHOLD = 1.0f / 256.0f;
+
+    unsigned int buffer;
+    unsigned int texture;
+
+    vector<DirLight> directionalLights;
+    vector<PointLight> pointLights;
+    vector<SpotLight> spotLights;
+
+    LightManager() : buffer(0), texture(0)
+    {
+        glGenBuffers(1, &buffer);
+        glGenTextures(1, &texture);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, LIGHT_TEXELS * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    LightManager(const LightManager&) = delete;
+    LightManager& operator=(const LightManager&) = delete;
+
+    // the Add functions return the index of the light in its typed vector
+    size_t Add(const DirLight &light) { directionalLights.push_back(light); return directionalLights.size() - 1; }
+    size_t Add(const PointLight &light) { pointLights.push_back(light); return pointLights.size() - 1; }
+    size_t Add(const SpotLight &light) { spotLights.push_back(light); return spotLights.size() - 1; }
+
+    unsigned int Count() const { return directionalLights.size() + pointLights.size() + spotLights.size(); }
+
+    // distance at which 1 / (constant + linear * d + quadratic * d^2), scaled by the brightest channel of the light,
+    // falls below RADIUS_THRESHOLD. FLT_MAX if it never does.
+    static float Radius(float constant, float linear, float quadratic, float intensity)
+    {
+        float c = constant - intensity / RADIUS_THRESHOLD;
+        if (c >= 0.0f)
+            return 0.0f;
+        if (quadratic > 0.0f)
+            return (-linear + sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+        if (linear > 0.0f)
+            return -c / linear;
+        return FLT_MAX;
+    }
+
+    // repacks the lights and uploads what changed, returns the number of bytes sent
+    size_t Upload()
+    {
+        pack();
+        size_t bytes = packed.size() * sizeof(glm::vec4);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        if (packed.size() != uploaded.size())
+        {
+            // a light was added or removed, the storage is reallocated (at least one light, empty buffers are not
+            // valid texture storage)
+            glBufferData(GL_TEXTURE_BUFFER, max(bytes, LIGHT_TEXELS * sizeof(glm::vec4)), packed.data(), GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+            uploaded = packed;
+            return bytes;
+        }
+        const unsigned char *current = reinterpret_cast<const unsigned char*>(packed.data());
+        unsigned char *previous = reinterpret_cast<unsigned char*>(uploaded.data());
+        size_t first = 0, last = bytes;
+        while (first < last && current[first] == previous[first])
+            first++;
+        while (last > first && current[last - 1] == previous[last - 1])
+            last--;
+        if (first < last)
+        {
+            glBufferSubData(GL_TEXTURE_BUFFER, first, last - first, current + first);
+            memcpy(previous + first, current + first, last - first);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        return last - first;
+    }
+
+    // binds the light texture to TEXTURE_UNIT and points the program's light uniforms at it, the program has to be
+    // bound (use)
+    void Bind(const Shader &shader) const
+    {
+        static constexpr UniformHandle<int> LIGHTS("lights");
+        static constexpr UniformHandle<int> DIRECTIONAL_LIGHT_COUNT("directionalLightCount");
+        glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glActiveTexture(GL_TEXTURE0);
+        shader.set(LIGHTS, int(TEXTURE_UNIT));
+        shader.set(DIRECTIONAL_LIGHT_COUNT, int(directionalLights.size()));
+    }
+
+    // view-independent bounding spheres (position, radius) of the point and spot lights from the last Upload, in
+    // packing order: sphere i belongs to light directionalLights.size() + i
+    const vector<glm::vec4> &Bounds() const { return bounds; }
+
+    void Delete()
+    {
+        glDeleteTextures(1, &texture);
+        glDeleteBuffers(1, &buffer);
+    }
+
+private:
+    vector<glm::vec4> packed;
+    vector<glm::vec4> uploaded;
+    vector<glm::vec4> bounds;
+
+    static float brightest(const glm::vec3 &ambient, const glm::vec3 &diffuse, const glm::vec3 &specular)
+    {
+        return max({ambient.x, ambient.y, ambient.z, diffuse.x, diffuse.y, diffuse.z, specular.x, specular.y, specular.z});
+    }
+
+    void pack()
+    {
+        packed.clear();
+        packed.reserve(Count() * LIGHT_TEXELS);
+        bounds.clear();
+        bounds.reserve(pointLights.size() + spotLights.size());
+        for (const DirLight &light : directionalLights)
+        {
+            packed.push_back(glm::vec4(0.0f, 0.0f, 0.0f, LIGHT_DIRECTIONAL));
+            packed.push_back(glm::vec4(light.direction, FLT_MAX));
+            packed.push_back(glm::vec4(light.ambient, 1.0f));
+            packed.push_back(glm::vec4(light.diffuse, 0.0f));
+            packed.push_back(glm::vec4(light.specular, 0.0f));
+            packed.push_back(glm::vec4(0.0f));
+        }
+        for (const PointLight &light : pointLights)
+        {
+            float radius = Radius(light.constant, light.linear, light.quadratic,
+                                  brightest(light.ambient, light.diffuse, light.specular));
+            bounds.push_back(glm::vec4(light.position, radius));
+            packed.push_back(glm::vec4(light.position, LIGHT_POINT));
+            packed.push_back(glm::vec4(0.0f, 0.0f, 0.0f, radius));
+            packed.push_back(glm::vec4(light.ambient, light.constant));
+            packed.push_back(glm::vec4(light.diffuse, light.linear));
+            packed.push_back(glm::vec4(light.specular, light.quadratic));
+            packed.push_back(glm::vec4(0.0f));
+        }
+        for (const SpotLight &light : spotLights)
+        {
+            float radius = Radius(light.constant, light.linear, light.quadratic,
+                                  brightest(light.ambient, light.diffuse, light.specular));
+            // the sphere around the apex is conservative for the cone
+            bounds.push_back(glm::vec4(light.position, radius));
+            packed.push_back(glm::vec4(light.position, LIGHT_SPOT));
+            packed.push_back(glm::vec4(light.direction, radius));
+            packed.push_back(glm::vec4(light.ambient, light.constant));
+            packed.push_back(glm::vec4(light.diffuse, light.linear));
+            packed.push_back(glm::vec4(light.specular, light.quadratic));
+            packed.push_back(glm::vec4(light.cutOff, light.outerCutOff, 0.0f, 0.0f));
+        }
+    }
+};
+#endif
@@ -0,0 +1,76 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// read-only memory mapping of a whole file, unmapped when it goes out of scope
+class MappedFile
+{
+public:
+    MappedFile() : data(nullptr), size(0) {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const string &path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping stays valid after the descriptor is closed
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+            return false;
+        data = static_cast<const unsigned char*>(mapping);
+        size = st.st_size;
+        return true;
+    }
+
+    void close()
+    {
+        if (data)
+            munmap(const_cast<unsigned char*>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+
+    const unsigned char *data;
+    size_t size;
+};
+
+// 64-bit FNV-1a, used to detect changed and duplicate files
+inline uint64_t hashBytes(const unsigned char *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline bool hashFile(const string &path, uint64_t &hash)
+{
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+    hash = hashBytes(file.data, file.size);
+    return true;
+}
+#endif
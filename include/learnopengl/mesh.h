@@ -6,64 +6,96 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/instance_buffer.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/vertex_format.h>
 
 #include <string>
 #include <vector>
 using namespace std;
 
-struct Vertex {
-    // position
-    glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
-    // texCoords
-    glm::vec2 TexCoords;
-    // tangent
-    glm::vec3 Tangent;
-    // bitangent
-    glm::vec3 Bitangent;
-};
-
-
-
 struct Texture {
     unsigned int id;
     string type;
     string path;
 };
 
+// cpu-side data of a mesh before it is uploaded
+struct MeshData {
+    vector<Vertex>       vertices;
+    vector<unsigned int> indices;
+    vector<Texture>      textures;
+};
+
 class Mesh {
 public:
-    // mesh Data
+    // layout new meshes are uploaded in, meshes whose uvs do not fit half floats fall back to VertexLayout::Float
+    static VertexLayout &DefaultLayout()
+    {
+        static VertexLayout layout = VertexLayout::Packed;
+        return layout;
+    }
+
+    // mesh Data. vertices and indices are only kept if the mesh was created with keepCpuData (e.g. for picking or
+    // collision), by default they are released once the geometry lives in the GPU buffers.
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
 
     unsigned int VAO;
+    unsigned int depthVAO;  // position-only stream for depth passes, shares the index buffer
+    unsigned int indexCount;
+    GLenum indexType;       // GL_UNSIGNED_SHORT when every index fits 16 bits
+    VertexLayout layout;
+    glm::vec3 positionScale;  // dequantization of VertexLayout::Quantized positions, identity otherwise
+    glm::vec3 positionOffset;
     std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor, takes over the geometry vectors
+    Mesh(vector<Vertex> &&vertices, vector<unsigned int> &&indices, vector<Texture> textures, bool keepCpuData = false)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
-
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+        SetShaderTextureNamePrefix("");
+        if (!keepCpuData)
+        {
+            vector<Vertex>().swap(this->vertices);
+            vector<unsigned int>().swap(this->indices);
+        }
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    // constructor for data that already lives in memory (e.g. a mapped mesh cache), it is uploaded
+    // straight from the given pointers. A cpu-side copy is only made for keepCpuData.
+    Mesh(const Vertex *vertexData, unsigned int vertexCount, const unsigned int *indexData, unsigned int indexCount, vector<Texture> textures, bool keepCpuData = false)
+        : textures(std::move(textures))
+    {
+        setupMesh(vertexData, vertexCount, indexData, indexCount);
+        SetShaderTextureNamePrefix("");
+        if (keepCpuData)
+        {
+            vertices.assign(vertexData, vertexData + vertexCount);
+            indices.assign(indexData, indexData + indexCount);
+        }
+    }
+
+    // meshes own their GL objects, so they are moved but never copied
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(Mesh&&) = default;
+
+    // sets the prefix of the sampler uniforms (e.g. "material.") and resolves the sampler names: the N-th texture of
+    // a type is bound to <prefix><type>N, e.g. material.texture_diffuse1
+    void SetShaderTextureNamePrefix(const std::string &prefix)
     {
-        // bind appropriate textures
+        glslIdentifierPrefix = prefix;
+        samplerHandles.clear();
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -75,63 +107,154 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to stream
             else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            samplerHandles.push_back(UniformHandle<int>(glslIdentifierPrefix + name + number));
         }
+    }
 
+    // the shader features the material of the mesh can use (see ShaderVariants), maps it lacks are not sampled
+    unsigned int Features() const
+    {
+        unsigned int features = 0;
+        for (const Texture &texture : textures)
+        {
+            if (texture.type == "texture_specular")
+                features |= SHADER_FEATURE_SPECULAR_MAP;
+            else if (texture.type == "texture_normal")
+                features |= SHADER_FEATURE_NORMAL_MAP;
+        }
+        return features;
+    }
 
+    // render the mesh
+    void Draw(Shader &shader)
+    {
+        bindTextures(shader);
 
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // renders count instances of the mesh in a single draw, the shader reads the model matrices from the
+    // instance buffer (see InstanceBuffer)
+    void DrawInstanced(Shader &shader, const InstanceBuffer &instances, unsigned int count)
+    {
+        bindTextures(shader);
+
+        glBindVertexArray(VAO);
+        // the instance attributes are VAO state, they only have to be set up again when the buffer changes
+        if (attachedInstances != instances.ID)
+        {
+            instances.Attach();
+            attachedInstances = instances.ID;
+        }
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, 0, count);
+        glBindVertexArray(0);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // depth-only draws from the position stream, for shaders that only read aPos (e.g. depth.vs)
+    void DrawDepth(Shader &shader)
+    {
+        setPositionUniforms(shader);
+        glBindVertexArray(depthVAO);
+        glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+        glBindVertexArray(0);
+    }
+
+    void DrawDepthInstanced(Shader &shader, const InstanceBuffer &instances, unsigned int count)
+    {
+        setPositionUniforms(shader);
+        glBindVertexArray(depthVAO);
+        if (attachedDepthInstances != instances.ID)
+        {
+            instances.Attach();
+            attachedDepthInstances = instances.ID;
+        }
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, 0, count);
+        glBindVertexArray(0);
+    }
+
 private:
     // render data
-    unsigned int VBO, EBO;
+    unsigned int VBO, EBO, positionVBO;
+    unsigned int attachedInstances = 0;
+    unsigned int attachedDepthInstances = 0;
+    vector<UniformHandle<int>> samplerHandles; // sampler uniform of every texture, see SetShaderTextureNamePrefix
+
+
+    // binds the mesh's textures to consecutive units, points the material samplers at them and sets the
+    // per-mesh uniforms
+    void bindTextures(Shader &shader)
+    {
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            // now set the sampler to the correct texture unit
+            shader.set(samplerHandles[i], int(i));
+            // and finally bind the texture
+            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        }
+
+        setPositionUniforms(shader);
+    }
+
+    void setPositionUniforms(Shader &shader)
+    {
+        static constexpr UniformHandle<glm::vec3> POSITION_SCALE("positionScale");
+        static constexpr UniformHandle<glm::vec3> POSITION_OFFSET("positionOffset");
+        shader.set(POSITION_SCALE, positionScale);
+        shader.set(POSITION_OFFSET, positionOffset);
+    }
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex *vertexData, unsigned int vertexCount, const unsigned int *indexData, unsigned int indexCount)
     {
+        this->indexCount = indexCount;
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
         glBindVertexArray(VAO);
-        // load data into vertex buffers
+        // load data into vertex buffers, converted to the mesh's layout
+        layout = ChooseVertexLayout(vertexData, vertexCount, DefaultLayout());
+        vector<unsigned char> packed = PackVertices(vertexData, vertexCount, layout, positionScale, positionOffset);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        if (vertexCount <= 65536)
+        {
+            vector<uint16_t> shortIndices(indexData, indexData + indexCount);
+            indexType = GL_UNSIGNED_SHORT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+        }
+        else
+        {
+            indexType = GL_UNSIGNED_INT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
+        }
+
+        // set the vertex attribute pointers from the layout's description
+        VertexFormat::Of(layout).Apply();
 
+        // the depth VAO reads the positions from their own buffer, so depth passes fetch 8 or 12 bytes per vertex
+        // instead of the whole vertex
+        vector<unsigned char> positions = ExtractPositions(packed, layout);
+        glGenVertexArrays(1, &depthVAO);
+        glGenBuffers(1, &positionVBO);
+        glBindVertexArray(depthVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+        glBufferData(GL_ARRAY_BUFFER, positions.size(), positions.data(), GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        VertexFormat::PositionsOf(layout).Apply();
 
         glBindVertexArray(0);
     }
@@ -0,0 +1,340 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mapped_file.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+// Binary mesh cache written next to each model source file (<model>.rgmesh).
+// It holds the already triangulated, tangent-generated vertex and index blobs exactly as Mesh uploads them,
+// plus the texture references of every mesh, so a warm start can skip the Assimp import entirely.
+//
+// The texture references come from the material libraries (mtllib) of the source, they are part of the cache key as
+// well: every library is recorded with its stamp and hash, an edited .mtl invalidates the cache like an edited .obj.
+//
+// file layout (every block is 4-byte aligned):
+//   MeshCacheHeader
+//   materialCount x { MeshCacheMaterial, path chars, padding }
+//   for every mesh:
+//     MeshCacheMeshHeader
+//     textureCount x { uint32 typeLength, uint32 pathLength, type chars, path chars, padding }
+//     vertexCount x Vertex
+//     indexCount x uint32
+const char MESH_CACHE_MAGIC[4] = {'R', 'G', 'M', 'C'};
+// bump whenever the layout or the import post-processing changes, old caches are then rebuilt
+const uint32_t MESH_CACHE_VERSION = 5;
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t meshCount;
+    uint64_t sourceSize;
+    int64_t sourceMtime;  // nanoseconds
+    uint64_t sourceHash;
+    uint32_t materialCount;
+    uint32_t reserved;
+};
+
+// a material library the source references, a library that did not exist when the cache was written has
+// exists == 0 and must still be missing
+struct MeshCacheMaterial {
+    uint32_t pathLength;  // path relative to the source's directory
+    uint32_t exists;
+    uint64_t size;
+    int64_t mtime;        // nanoseconds
+    uint64_t hash;
+};
+
+struct MeshCacheMeshHeader {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t textureCount;
+    uint32_t reserved;
+};
+
+// size and modification time of a source file, the cheap part of the cache key. The mtime keeps the nanoseconds,
+// whole seconds would miss an edit that keeps the size within the second the cache was written in.
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;  // nanoseconds since the epoch
+
+    static bool of(const string &path, SourceStamp &stamp)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return false;
+        stamp.size = st.st_size;
+        stamp.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        return true;
+    }
+};
+
+class MeshCache
+{
+public:
+    // view of a single cached mesh, the pointers point straight into the mapped cache file
+    struct MeshView {
+        const Vertex *vertices;
+        unsigned int vertexCount;
+        const unsigned int *indices;
+        unsigned int indexCount;
+        vector<Texture> textures;
+    };
+
+    static string cachePathFor(const string &sourcePath)
+    {
+        return sourcePath + ".rgmesh";
+    }
+
+    // maps the cache file of the given source and validates it. The cache is valid if the source still has
+    // the recorded size and mtime, or if its content hash still matches (the mtime is then refreshed).
+    bool open(const string &sourcePath)
+    {
+        meshes.clear();
+        SourceStamp stamp;
+        if (!SourceStamp::of(sourcePath, stamp))
+            return false;
+        string cachePath = cachePathFor(sourcePath);
+        if (!file.open(cachePath))
+            return false;
+        if (file.size < sizeof(MeshCacheHeader))
+            return fail();
+
+        MeshCacheHeader header;
+        memcpy(&header, file.data, sizeof(header));
+        if (memcmp(header.magic, MESH_CACHE_MAGIC, 4) != 0 || header.version != MESH_CACHE_VERSION || header.vertexSize != sizeof(Vertex))
+            return fail();
+
+        if (!upToDate(sourcePath, stamp, header.sourceSize, header.sourceMtime, header.sourceHash, cachePath,
+                      offsetof(MeshCacheHeader, sourceMtime)))
+            return fail();
+
+        size_t offset = sizeof(MeshCacheHeader);
+        string directory = directoryOf(sourcePath);
+        for (uint32_t i = 0; i < header.materialCount; i++)
+        {
+            size_t materialOffset = offset;
+            MeshCacheMaterial material;
+            if (!read(offset, &material, sizeof(material)) || offset + material.pathLength > file.size)
+                return fail();
+            string path = directory + string(reinterpret_cast<const char*>(file.data + offset), material.pathLength);
+            offset = align4(offset + material.pathLength);
+            SourceStamp materialStamp;
+            bool exists = SourceStamp::of(path, materialStamp);
+            if (exists != bool(material.exists))
+                return fail();
+            if (exists && !upToDate(path, materialStamp, material.size, material.mtime, material.hash, cachePath,
+                                    materialOffset + offsetof(MeshCacheMaterial, mtime)))
+                return fail();
+        }
+
+        for (uint32_t i = 0; i < header.meshCount; i++)
+        {
+            MeshCacheMeshHeader meshHeader;
+            if (!read(offset, &meshHeader, sizeof(meshHeader)))
+                return fail();
+
+            MeshView view;
+            for (uint32_t t = 0; t < meshHeader.textureCount; t++)
+            {
+                uint32_t lengths[2];
+                if (!read(offset, lengths, sizeof(lengths)) || offset + lengths[0] + lengths[1] > file.size)
+                    return fail();
+                Texture texture;
+                texture.id = 0;
+                texture.type.assign(reinterpret_cast<const char*>(file.data + offset), lengths[0]);
+                texture.path.assign(reinterpret_cast<const char*>(file.data + offset + lengths[0]), lengths[1]);
+                offset = align4(offset + lengths[0] + lengths[1]);
+                view.textures.push_back(texture);
+            }
+
+            size_t vertexBytes = size_t(meshHeader.vertexCount) * sizeof(Vertex);
+            size_t indexBytes = size_t(meshHeader.indexCount) * sizeof(unsigned int);
+            if (offset + vertexBytes + indexBytes > file.size)
+                return fail();
+            view.vertices = reinterpret_cast<const Vertex*>(file.data + offset);
+            view.vertexCount = meshHeader.vertexCount;
+            offset += vertexBytes;
+            view.indices = reinterpret_cast<const unsigned int*>(file.data + offset);
+            view.indexCount = meshHeader.indexCount;
+            offset += indexBytes;
+            meshes.push_back(view);
+        }
+        return true;
+    }
+
+    // releases the mapping, the mesh views are invalid afterwards
+    void close()
+    {
+        meshes.clear();
+        file.close();
+    }
+
+    // writes the cache for the given source from the imported cpu-side mesh data
+    static bool write(const string &sourcePath, const vector<const MeshData*> &sourceMeshes)
+    {
+        SourceStamp stamp;
+        uint64_t hash;
+        if (!SourceStamp::of(sourcePath, stamp) || !hashFile(sourcePath, hash))
+            return false;
+
+        string cachePath = cachePathFor(sourcePath);
+        // write to a temporary file first so a concurrently starting instance never maps a half written cache
+        string tmpPath = cachePath + ".tmp";
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::MESH_CACHE:: could not write " << cachePath << std::endl;
+            return false;
+        }
+
+        MeshCacheHeader header;
+        memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+        header.version = MESH_CACHE_VERSION;
+        header.vertexSize = sizeof(Vertex);
+        header.meshCount = sourceMeshes.size();
+        header.sourceSize = stamp.size;
+        header.sourceMtime = stamp.mtime;
+        header.sourceHash = hash;
+        vector<string> materials = materialLibraries(sourcePath);
+        header.materialCount = materials.size();
+        header.reserved = 0;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        const char padding[4] = {0, 0, 0, 0};
+        string directory = directoryOf(sourcePath);
+        for (const string &path : materials)
+        {
+            MeshCacheMaterial material = {};
+            material.pathLength = path.size();
+            SourceStamp materialStamp;
+            if (SourceStamp::of(directory + path, materialStamp) && hashFile(directory + path, material.hash))
+            {
+                material.exists = 1;
+                material.size = materialStamp.size;
+                material.mtime = materialStamp.mtime;
+            }
+            else
+            {
+                material.hash = 0;
+            }
+            out.write(reinterpret_cast<const char*>(&material), sizeof(material));
+            out.write(path.data(), path.size());
+            out.write(padding, align4(path.size()) - path.size());
+        }
+        for (const MeshData *meshData : sourceMeshes)
+        {
+            const MeshData &mesh = *meshData;
+            MeshCacheMeshHeader meshHeader;
+            meshHeader.vertexCount = mesh.vertices.size();
+            meshHeader.indexCount = mesh.indices.size();
+            meshHeader.textureCount = mesh.textures.size();
+            meshHeader.reserved = 0;
+            out.write(reinterpret_cast<const char*>(&meshHeader), sizeof(meshHeader));
+
+            for (const Texture &texture : mesh.textures)
+            {
+                uint32_t lengths[2] = { uint32_t(texture.type.size()), uint32_t(texture.path.size()) };
+                out.write(reinterpret_cast<const char*>(lengths), sizeof(lengths));
+                out.write(texture.type.data(), lengths[0]);
+                out.write(texture.path.data(), lengths[1]);
+                out.write(padding, align4(lengths[0] + lengths[1]) - (lengths[0] + lengths[1]));
+            }
+            out.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+            out.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(unsigned int));
+        }
+        out.close();
+        if (!out || rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+        {
+            std::cout << "ERROR::MESH_CACHE:: could not write " << cachePath << std::endl;
+            unlink(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    vector<MeshView> meshes;
+
+private:
+    MappedFile file;
+
+    static size_t align4(size_t offset)
+    {
+        return (offset + 3) & ~size_t(3);
+    }
+
+    bool read(size_t &offset, void *dst, size_t size)
+    {
+        if (offset + size > file.size)
+            return false;
+        memcpy(dst, file.data + offset, size);
+        offset += size;
+        return true;
+    }
+
+    bool fail()
+    {
+        close();
+        return false;
+    }
+
+    // a file is unchanged if it still has the recorded size and mtime, or if its content hash still matches. The
+    // recorded mtime at mtimeOffset in the cache is refreshed then.
+    static bool upToDate(const string &path, const SourceStamp &stamp, uint64_t size, int64_t mtime, uint64_t hash,
+                         const string &cachePath, size_t mtimeOffset)
+    {
+        if (size == stamp.size && mtime == stamp.mtime)
+            return true;
+        // the file was touched, only its content decides whether the cache is stale
+        uint64_t currentHash;
+        if (size != stamp.size || !hashFile(path, currentHash) || currentHash != hash)
+            return false;
+        refreshMtime(cachePath, mtimeOffset, stamp.mtime);
+        return true;
+    }
+
+    static void refreshMtime(const string &cachePath, size_t offset, int64_t mtime)
+    {
+        std::fstream out(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(offset);
+        out.write(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+    }
+
+    static string directoryOf(const string &sourcePath)
+    {
+        size_t slash = sourcePath.find_last_of('/');
+        return slash == string::npos ? string() : sourcePath.substr(0, slash + 1);
+    }
+
+    // the mtllib statements of an .obj, the rest of the line is the library's path like Assimp reads it
+    static vector<string> materialLibraries(const string &sourcePath)
+    {
+        vector<string> libraries;
+        std::ifstream in(sourcePath);
+        string line;
+        while (std::getline(in, line))
+        {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == string::npos || line.compare(start, 6, "mtllib") != 0 || start + 6 >= line.size() ||
+                (line[start + 6] != ' ' && line[start + 6] != '\t'))
+                continue;
+            size_t begin = line.find_first_not_of(" \t", start + 6);
+            size_t end = line.find_last_not_of(" \t\r");
+            if (begin != string::npos && end >= begin)
+                libraries.push_back(line.substr(begin, end - begin + 1));
+        }
+        return libraries;
+    }
+};
+#endif
@@ -11,13 +11,18 @@
 #include <assimp/postprocess.h>
 
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_optimizer.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_manager.h>
+#include <learnopengl/cpu_profiler.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
@@ -33,13 +38,68 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // keep the meshes' vertices and indices in memory after the upload, for models that are picked or collided with.
+    // Set before Import, by default only the GPU buffers hold the geometry.
+    bool keepCpuData = false;
+
+    // constructs an empty model, fill it with Import followed by Finalize (see ModelLoader).
+    Model() : gammaCorrection(false) {}
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, bool keepCpuData = false) : gammaCorrection(gamma), keepCpuData(keepCpuData)
+    {
+        Import(path);
+        Finalize();
+    }
+
+    // gives the model's references back to the TextureManager
+    ~Model()
     {
+        for (const Texture &texture : textures_loaded)
+        {
+            if (texture.id)
+                TextureManager::Instance().Release(texture.id);
+        }
+    }
+
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    // cpu-side part of loading: reads the mesh cache or runs the Assimp import, builds the vertex data and hashes
+    // the texture files for the TextureManager. Makes no GL calls, so it is safe to run on a worker thread.
+    void Import(string const &path)
+    {
+        PROFILE_ZONE("Model::Import");
         loadModel(path);
     }
 
+    // GL part of loading: acquires the textures from the TextureManager and creates the mesh buffers from the data
+    // prepared by Import. With an active TextureStreamer the textures start out as placeholders and are streamed in
+    // over the next frames. Must run on the thread that owns the GL context.
+    void Finalize()
+    {
+        PROFILE_ZONE("Model::Finalize");
+        for (unsigned int i = 0; i < textures_loaded.size(); i++)
+            textures_loaded[i].id = TextureManager::Instance().Acquire2D(this->directory + '/' + textures_loaded[i].path, false, pendingHashes[i]);
+
+        meshes.reserve(meshes.size() + pendingMeshes.size());
+        for (PendingMesh &pending : pendingMeshes)
+        {
+            for (Texture &texture : pending.data.textures)
+                texture.id = textures_loaded[texture_index[texture.path]].id;
+
+            if (pending.vertexData)
+                meshes.push_back(Mesh(pending.vertexData, pending.vertexCount, pending.indexData, pending.indexCount, std::move(pending.data.textures), keepCpuData));
+            else
+                meshes.push_back(Mesh(std::move(pending.data.vertices), std::move(pending.data.indices), std::move(pending.data.textures), keepCpuData));
+        }
+
+        vector<PendingMesh>().swap(pendingMeshes);
+        pendingHashes.clear();
+        // everything has been uploaded, the mapped cache file is no longer needed
+        cache.close();
+    }
+
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
@@ -47,15 +107,117 @@ public:
             meshes[i].Draw(shader);
     }
 
+    // draws count instances of the model with one draw per mesh. shader has to take the model matrix from the
+    // instance attribute at locations 5-8, e.g. the SHADER_FEATURE_INSTANCED variant of model_lighting.vs
+    void DrawInstanced(Shader &shader, const InstanceBuffer &instances, unsigned int count)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawInstanced(shader, instances, count);
+    }
+
+    // depth-only versions of Draw and DrawInstanced, they read the meshes' position streams and bind no textures
+    void DrawDepth(Shader &shader)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawDepth(shader);
+    }
+
+    void DrawDepthInstanced(Shader &shader, const InstanceBuffer &instances, unsigned int count)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawDepthInstanced(shader, instances, count);
+    }
+
+    // the same draws through a set of shader variants: every mesh uses the cheapest variant its material allows,
+    // transform is set as the model matrix of each variant
+    void Draw(ShaderVariants &variants, const glm::mat4 &transform)
+    {
+        static constexpr UniformHandle<glm::mat4> MODEL("model");
+        drawVariants(variants, 0, [&](Mesh &mesh, Shader &shader) {
+            shader.set(MODEL, transform);
+            mesh.Draw(shader);
+        });
+    }
+
+    void DrawInstanced(ShaderVariants &variants, const InstanceBuffer &instances, unsigned int count)
+    {
+        drawVariants(variants, SHADER_FEATURE_INSTANCED, [&](Mesh &mesh, Shader &shader) {
+            mesh.DrawInstanced(shader, instances, count);
+        });
+    }
+
+    void DrawDepth(ShaderVariants &variants, const glm::mat4 &transform)
+    {
+        static constexpr UniformHandle<glm::mat4> MODEL("model");
+        drawVariants(variants, 0, [&](Mesh &mesh, Shader &shader) {
+            shader.set(MODEL, transform);
+            mesh.DrawDepth(shader);
+        });
+    }
+
+    void DrawDepthInstanced(ShaderVariants &variants, const InstanceBuffer &instances, unsigned int count)
+    {
+        drawVariants(variants, SHADER_FEATURE_INSTANCED, [&](Mesh &mesh, Shader &shader) {
+            mesh.DrawDepthInstanced(shader, instances, count);
+        });
+    }
+
+    // submits the variants Draw (or DrawInstanced with SHADER_FEATURE_INSTANCED) will use to the batch
+    void PrepareVariants(ShaderVariants &variants, ShaderBatch &batch, unsigned int extraFeatures = 0)
+    {
+        for (Mesh &mesh : meshes)
+            variants.Prepare(mesh.Features() | extraFeatures, batch);
+    }
+
     void SetShaderTextureNamePrefix(std::string prefix) {
         for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+            mesh.SetShaderTextureNamePrefix(prefix);
         }
     }
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    // binds the variant of every mesh, switching programs only when the features change from one mesh to the next
+    template <typename DrawMesh>
+    void drawVariants(ShaderVariants &variants, unsigned int extraFeatures, DrawMesh drawMesh)
+    {
+        PROFILE_ZONE("Model::Draw");
+        Shader *shader = nullptr;
+        unsigned int boundFeatures = 0;
+        for (Mesh &mesh : meshes)
+        {
+            unsigned int features = mesh.Features() | extraFeatures;
+            if (!shader || features != boundFeatures)
+            {
+                shader = &variants.Use(features);
+                boundFeatures = features;
+            }
+            drawMesh(mesh, *shader);
+        }
+    }
+
+    // a mesh that has been imported but not yet uploaded. Its geometry either lives in data (Assimp import)
+    // or in the mapped mesh cache, in which case vertexData/indexData point into the mapping.
+    struct PendingMesh {
+        MeshData data;
+        const Vertex *vertexData = nullptr;
+        unsigned int vertexCount = 0;
+        const unsigned int *indexData = nullptr;
+        unsigned int indexCount = 0;
+    };
+    vector<PendingMesh> pendingMeshes;
+    vector<uint64_t> pendingHashes; // content hash of every entry of textures_loaded
+    unordered_map<string, unsigned int> texture_index; // path -> position in textures_loaded
+    MeshCache cache;
+
+    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the pendingMeshes vector.
     void loadModel(string const &path)
     {
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // a valid binary mesh cache next to the model lets us skip the Assimp import entirely
+        if (loadFromCache(path))
+            return;
+
         // read file via ASSIMP
         Assimp::Importer importer;
         const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
@@ -65,15 +227,41 @@ private:
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
-
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        VertexCacheStats before, after;
+        processNode(scene->mRootNode, scene, before, after);
+        cout << "MESH_OPTIMIZER:: " << path << ": vertices " << before.vertices << " -> " << after.vertices
+             << ", ACMR " << before.ACMR() << " -> " << after.ACMR() << ", ATVR " << before.ATVR() << " -> " << after.ATVR() << endl;
+
+        // store the imported meshes so the next start can use the cache
+        vector<const MeshData*> imported;
+        for (const PendingMesh &pending : pendingMeshes)
+            imported.push_back(&pending.data);
+        MeshCache::write(path, imported);
+    }
+
+    // takes all meshes from the binary mesh cache. The vertex and index blobs stay in the mapped file until
+    // Finalize uploads them. returns false if the cache is missing or stale.
+    bool loadFromCache(string const &path)
+    {
+        if (!cache.open(path))
+            return false;
+        for (MeshCache::MeshView &view : cache.meshes)
+        {
+            PendingMesh pending;
+            for (const Texture &ref : view.textures)
+                pending.data.textures.push_back(loadTexture(ref.path, ref.type));
+            pending.vertexData = view.vertices;
+            pending.vertexCount = view.vertexCount;
+            pending.indexData = view.indices;
+            pending.indexCount = view.indexCount;
+            pendingMeshes.push_back(std::move(pending));
+        }
+        return true;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    void processNode(aiNode *node, const aiScene *scene, VertexCacheStats &before, VertexCacheStats &after)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -81,27 +269,38 @@ private:
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            PendingMesh pending;
+            pending.data = processMesh(mesh, scene);
+            VertexCacheStats meshBefore, meshAfter;
+            OptimizeMesh(pending.data, meshBefore, meshAfter);
+            before += meshBefore;
+            after += meshAfter;
+            pendingMeshes.push_back(std::move(pending));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, before, after);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    MeshData processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData data;
+        vector<Vertex> &vertices = data.vertices;
+        vector<unsigned int> &indices = data.indices;
+        vector<Texture> &textures = data.textures;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
+            // zeroed: the weld compares and hashes whole vertices and the mesh cache stores their bytes, members a mesh
+            // has no data for must not hold garbage
+            Vertex vertex{};
             glm::vec3 vector; // we declare a placeholder vector since assimp_ uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
             // positions
             vector.x = mesh->mVertices[i].x;
@@ -137,7 +336,11 @@ private:
                 vertex.Bitangent = vector;
             }
             else
+            {
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+                vertex.Tangent = glm::vec3(0.0f);
+                vertex.Bitangent = glm::vec3(0.0f);
+            }
 
             vertices.push_back(vertex);
 
@@ -178,8 +381,8 @@ private:
 
 
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the extracted mesh data, the mesh object itself is created by Finalize
+        return data;
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -191,29 +394,32 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            textures.push_back(loadTexture(str.C_Str(), typeName));
         }
         return textures;
     }
+
+    // registers a single texture of the model, unless a texture with the same path has already been registered.
+    // only the file is hashed here, the GL texture is acquired by Finalize.
+    Texture loadTexture(string const &path, string const &typeName)
+    {
+        // check if texture was loaded before and if so, reuse it: skip loading a new texture
+        auto it = texture_index.find(path);
+        if (it != texture_index.end())
+            return textures_loaded[it->second]; // a texture with the same filepath has already been loaded (optimization)
+
+        // if texture hasn't been loaded already, load it
+        Texture texture;
+        texture.id = 0;
+        texture.type = typeName;
+        texture.path = path;
+        texture_index[path] = textures_loaded.size();
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        uint64_t hash = 0;
+        hashFile(this->directory + '/' + path, hash);
+        pendingHashes.push_back(hash);
+        return texture;
+    }
 };
 
 
@@ -222,38 +428,6 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    return TextureManager::Instance().Acquire2D(filename);
 }
 #endif
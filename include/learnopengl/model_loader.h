@@ -0,0 +1,73 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <learnopengl/model.h>
+#include <learnopengl/thread_pool.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// loads several models in parallel. The cpu-side work of every model (mesh cache / Assimp import, vertex building,
+// image decoding) runs on a worker pool, the GL finalization is handed back to the thread that calls Finish.
+//
+//     ModelLoader loader;
+//     loader.Load(fieldModel, "resources/objects/field/model.obj");
+//     loader.Load(cowModel, "resources/objects/cow/cow.obj");
+//     ... other work on the GL thread ...
+//     loader.Finish();
+class ModelLoader
+{
+public:
+    explicit ModelLoader(unsigned int threadCount = 0) : outstanding(0), pool(threadCount, "Model loader") {}
+
+    ModelLoader(const ModelLoader&) = delete;
+    ModelLoader& operator=(const ModelLoader&) = delete;
+
+    // queues the import of path into model, the model must stay alive until Finish returns
+    void Load(Model &model, std::string const &path, bool gamma = false)
+    {
+        model.gammaCorrection = gamma;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            outstanding++;
+        }
+        Model *target = &model;
+        pool.Submit([this, target, path]() {
+            target->Import(path);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                imported.push_back(target);
+            }
+            modelImported.notify_one();
+        });
+    }
+
+    // finalizes models on the calling (GL) thread in the order their imports complete, returns when all are done
+    void Finish()
+    {
+        PROFILE_ZONE("ModelLoader::Finish");
+        std::unique_lock<std::mutex> lock(mutex);
+        while (outstanding > 0)
+        {
+            modelImported.wait(lock, [this]() { return !imported.empty(); });
+            Model *model = imported.front();
+            imported.pop_front();
+            outstanding--;
+            // upload without holding the lock so the workers can keep reporting
+            lock.unlock();
+            model->Finalize();
+            lock.lock();
+        }
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable modelImported;
+    std::deque<Model*> imported;
+    unsigned int outstanding;
+    // declared last so the workers are joined before the state they report to is destroyed
+    ThreadPool pool;
+};
+#endif
@@ -0,0 +1,173 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/mapped_file.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Linked programs persisted with glGetProgramBinary, one file per program in a cache directory
+// (<directory>/<key>.glprog). The key hashes the preprocessed source of every stage, which already contains the
+// injected defines and the expanded includes, together with the GL vendor, renderer and version strings, so a
+// driver update or a changed include file simply misses.
+//
+// file layout:
+//   ProgramCacheHeader
+//   binaryLength bytes of driver binary
+//
+// Drivers may still reject a binary they wrote themselves (e.g. after an update that kept the version string),
+// Load then reports a miss and the caller compiles as usual; the next Store overwrites the stale file.
+const char PROGRAM_CACHE_MAGIC[4] = {'R', 'G', 'P', 'B'};
+// bump whenever the layout or the key changes, old files are then ignored
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+
+class ProgramCache
+{
+public:
+    // directory the binaries are written to, created on the first Store. Empty disables the cache.
+    static string &Directory()
+    {
+        static string directory = "shader_cache";
+        return directory;
+    }
+
+    static bool Enabled()
+    {
+        return GLExt().programBinary && !Directory().empty();
+    }
+
+    // key of a program built from the given preprocessed stage sources, 0 stands for a missing stage
+    static uint64_t Key(const string &vertexCode, const string &fragmentCode, const string &geometryCode)
+    {
+        uint64_t hash = driverHash();
+        for (const string *code : {&vertexCode, &fragmentCode, &geometryCode})
+        {
+            uint64_t length = code->size();
+            // the length separates the stages, "ab" + "c" must not equal "a" + "bc"
+            hash = hashBytes(reinterpret_cast<const unsigned char*>(&length), sizeof(length), hash);
+            hash = hashBytes(reinterpret_cast<const unsigned char*>(code->data()), code->size(), hash);
+        }
+        return hash;
+    }
+
+    // loads the cached binary into program, returns true if the driver accepted it and the program is linked
+    static bool Load(GLuint program, uint64_t key)
+    {
+        if (!Enabled())
+            return false;
+        MappedFile file;
+        if (!file.open(pathFor(key)) || file.size < sizeof(ProgramCacheHeader))
+            return false;
+        ProgramCacheHeader header;
+        memcpy(&header, file.data, sizeof(header));
+        if (memcmp(header.magic, PROGRAM_CACHE_MAGIC, 4) != 0 || header.version != PROGRAM_CACHE_VERSION ||
+            header.key != key || sizeof(header) + header.binaryLength > file.size)
+            return false;
+
+        GLExt().ProgramBinary(program, header.binaryFormat, file.data + sizeof(header), header.binaryLength);
+        // an unknown format raises GL_INVALID_ENUM, don't leave it for the next glGetError
+        while (glGetError() != GL_NO_ERROR)
+            ;
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        return linked == GL_TRUE;
+    }
+
+    // call before glLinkProgram of a program that is going to be stored, some drivers only keep the binary then
+    static void PrepareLink(GLuint program)
+    {
+        if (Enabled())
+            GLExt().ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // writes the binary of a successfully linked program
+    static bool Store(GLuint program, uint64_t key)
+    {
+        if (!Enabled())
+            return false;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return false;
+        vector<unsigned char> binary(length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        GLExt().GetProgramBinary(program, length, &written, &format, binary.data());
+        if (written <= 0)
+            return false;
+
+        mkdir(Directory().c_str(), 0755);
+        string path = pathFor(key);
+        // write to a temporary file first so a concurrently starting instance never loads a half written binary
+        string tmpPath = path + ".tmp";
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::PROGRAM_CACHE:: could not write " << path << std::endl;
+            return false;
+        }
+        ProgramCacheHeader header;
+        memcpy(header.magic, PROGRAM_CACHE_MAGIC, 4);
+        header.version = PROGRAM_CACHE_VERSION;
+        header.key = key;
+        header.binaryFormat = format;
+        header.binaryLength = written;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(binary.data()), written);
+        out.close();
+        if (!out || rename(tmpPath.c_str(), path.c_str()) != 0)
+        {
+            std::cout << "ERROR::PROGRAM_CACHE:: could not write " << path << std::endl;
+            unlink(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static string pathFor(uint64_t key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.glprog", (unsigned long long)key);
+        return Directory() + "/" + name;
+    }
+
+    // vendor, renderer and version of the current context, queried once
+    static uint64_t driverHash()
+    {
+        static uint64_t hash = 0;
+        if (hash == 0)
+        {
+            hash = 14695981039346656037ull;
+            for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+            {
+                const char *value = (const char*)glGetString(name);
+                string text = value ? value : "";
+                text += '\n';
+                hash = hashBytes(reinterpret_cast<const unsigned char*>(text.data()), text.size(), hash);
+            }
+        }
+        return hash;
+    }
+};
+#endif
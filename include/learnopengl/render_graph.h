@@ -0,0 +1,634 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/gpu_timer.h>
+#include <learnopengl/cpu_profiler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// The frame as a list of passes that declare the render targets they read and write. The graph is declared again
+// every frame (Reset, Create, AddPass) and then run (Execute), which
+//
+//   - culls passes none of whose outputs are read later, unless they have a side effect (the window's framebuffer),
+//     and drops color outputs nobody reads from the framebuffers of the passes that are kept
+//   - allocates the targets from a pool just before their first use and hands them back after their last one, so
+//     targets of the same format and size whose lifetimes don't overlap share a texture
+//   - clears a target when it is first written, its content is undefined before
+//   - binds a cached framebuffer with the pass's attachments and sets the viewport
+//
+// Target sizes are relative to the graph size (the window); Resize drops the pool when it changes. A render scale
+// below 1 renders into the lower left part of every target only (dynamic resolution), UvScale tells the passes that
+// sample a target which part that is. Targets made with CreateUnscaled are always rendered in full, they are for
+// the passes after the upscale. Multisampled targets can't be sampled with texture(), AddBlit resolves them.
+//
+// A resource that is written by several passes is one texture for all of them, later writers load what earlier
+// ones left. Passes sharing a GpuTimer (Time) have to be consecutive, the timer then spans all of them.
+// Like the other GL objects the pool is deleted explicitly (Delete) while the context is current.
+class RenderGraph
+{
+public:
+    typedef unsigned int Resource;
+    // the window's framebuffer, writing it is a side effect
+    static const Resource BACKBUFFER = 0;
+    // pooled textures that were not used for this many frames are deleted
+    static const unsigned int EVICT_FRAMES = 120;
+
+    class PassBuilder
+    {
+    public:
+        PassBuilder(RenderGraph &graph, size_t pass) : graph(graph), pass(pass) {}
+
+        // sampled by the pass, graph.Texture(resource) is valid while it runs
+        PassBuilder &Read(Resource resource)
+        {
+            graph.passes[pass].reads.push_back(resource);
+            return *this;
+        }
+        // next color attachment, in the order of the fragment outputs. clear = false for passes that overwrite every
+        // pixel anyway.
+        PassBuilder &Write(Resource resource, bool clear = true)
+        {
+            graph.passes[pass].colors.push_back(resource);
+            graph.passes[pass].clearColors.push_back(clear);
+            return *this;
+        }
+        // depth attachment, the pass depth tests against it and may write it
+        PassBuilder &Depth(Resource resource)
+        {
+            graph.passes[pass].depth = resource;
+            return *this;
+        }
+        PassBuilder &Time(GpuTimer *timer)
+        {
+            graph.passes[pass].timer = timer;
+            return *this;
+        }
+        // never culled
+        PassBuilder &SideEffect()
+        {
+            graph.passes[pass].sideEffect = true;
+            return *this;
+        }
+
+    private:
+        RenderGraph &graph;
+        size_t pass;
+    };
+
+    RenderGraph(unsigned int width, unsigned int height) : width(width), height(height), renderScale(1.0f), frame(0),
+                                                           backbuffer(0)
+    {
+        Reset();
+    }
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    unsigned int Width() const { return width; }
+    unsigned int Height() const { return height; }
+
+    // new window size, the pooled targets are reallocated at their next use
+    void Resize(unsigned int width, unsigned int height)
+    {
+        if (width == this->width && height == this->height)
+            return;
+        this->width = width;
+        this->height = height;
+        Delete();
+    }
+
+    // framebuffer that stands for BACKBUFFER, the window's (0) unless rendering offscreen
+    void SetBackbuffer(unsigned int framebuffer)
+    {
+        backbuffer = framebuffer;
+    }
+
+    // fraction of every target rendered this frame, in (0, 1]
+    void SetRenderScale(float scale)
+    {
+        renderScale = std::min(std::max(scale, 0.01f), 1.0f);
+    }
+
+    // starts declaring the next frame
+    void Reset()
+    {
+        passes.clear();
+        resources.clear();
+        ResourceNode backbuffer;
+        backbuffer.name = "Backbuffer";
+        backbuffer.format = GL_NONE;
+        backbuffer.scale = 1.0f;
+        backbuffer.unscaled = true;
+        resources.push_back(backbuffer);
+    }
+
+    // a transient target of internalFormat, scale times the graph size. samples > 1 makes a multisampled target.
+    Resource Create(const std::string &name, GLenum internalFormat, float scale = 1.0f, unsigned int samples = 1)
+    {
+        ResourceNode resource;
+        resource.name = name;
+        resource.format = internalFormat;
+        resource.scale = scale;
+        resource.samples = std::max(1u, samples);
+        resources.push_back(resource);
+        return resources.size() - 1;
+    }
+
+    // a target at the graph size that ignores the render scale
+    Resource CreateUnscaled(const std::string &name, GLenum internalFormat)
+    {
+        Resource resource = Create(name, internalFormat);
+        resources[resource].unscaled = true;
+        return resource;
+    }
+
+    PassBuilder AddPass(const std::string &name, std::function<void()> execute)
+    {
+        Pass pass;
+        pass.name = name;
+#ifdef CPU_PROFILER_ENABLED
+        pass.zoneName = zoneName(name);
+#endif
+        pass.execute = std::move(execute);
+        passes.push_back(std::move(pass));
+        return PassBuilder(*this, passes.size() - 1);
+    }
+
+    // copies the rendered region of the color target source into target with glBlitFramebuffer, which resolves a
+    // multisampled source. Both need the same size.
+    PassBuilder AddBlit(const std::string &name, Resource source, Resource target)
+    {
+        return AddPass(name, [this, source, target]() { blit(source, target); }).Read(source).Write(target, false);
+    }
+
+    // culls, allocates and runs the passes declared since Reset
+    void Execute()
+    {
+        PROFILE_ZONE("RenderGraph::Execute");
+        frame++;
+        cull();
+        computeLifetimes();
+
+        timers.clear();
+        GpuTimer *runningTimer = nullptr;
+        for (size_t i = 0; i < passes.size(); i++)
+        {
+            Pass &pass = passes[i];
+            if (pass.culled)
+                continue;
+            for (Resource resource : pass.used)
+                if (resources[resource].first == i)
+                    acquire(resources[resource]);
+
+            if (pass.timer != runningTimer)
+            {
+                if (runningTimer)
+                    runningTimer->End();
+                if (pass.timer)
+                {
+                    pass.timer->Begin();
+                    timers.push_back(pass.timer);
+                }
+                runningTimer = pass.timer;
+            }
+            {
+                PROFILE_ZONE(pass.zoneName);
+                bindTargets(i);
+                pass.execute();
+            }
+
+            for (Resource resource : pass.used)
+                if (resources[resource].last == i)
+                    release(resources[resource]);
+        }
+        if (runningTimer)
+            runningTimer->End();
+        glBindFramebuffer(GL_FRAMEBUFFER, backbuffer);
+        evict();
+    }
+
+    // texture of a target, valid while a pass that uses it runs
+    unsigned int Texture(Resource resource) const
+    {
+        return resources[resource].texture;
+    }
+
+    // size of the part of a target that is rendered this frame
+    glm::ivec2 Region(Resource resource) const
+    {
+        glm::ivec2 size = allocatedSize(resources[resource]);
+        if (resources[resource].unscaled)
+            return size;
+        return glm::ivec2(std::max(1, int(std::lround(size.x * renderScale))), std::max(1, int(std::lround(size.y * renderScale))));
+    }
+
+    // rendered part of a full size target, e.g. the area the light clusters cover
+    glm::ivec2 RenderSize() const
+    {
+        return glm::ivec2(std::max(1, int(std::lround(width * renderScale))), std::max(1, int(std::lround(height * renderScale))));
+    }
+
+    // texture coordinates of the upper right corner of the rendered part, multiply [0, 1] coordinates with it
+    glm::vec2 UvScale(Resource resource) const
+    {
+        if (resources[resource].unscaled)
+            return glm::vec2(1.0f);
+        glm::ivec2 region = Region(resource), size = allocatedSize(resources[resource]);
+        return glm::vec2(float(region.x) / size.x, float(region.y) / size.y);
+    }
+
+    // GPU timers of the passes that ran in the last Execute, in order
+    const vector<GpuTimer*> &Timers() const { return timers; }
+
+    // statistics of the last Execute
+    unsigned int ExecutedPasses() const
+    {
+        unsigned int count = 0;
+        for (const Pass &pass : passes)
+            count += pass.culled ? 0 : 1;
+        return count;
+    }
+    unsigned int CulledPasses() const { return passes.size() - ExecutedPasses(); }
+    size_t PooledTextures() const { return pool.size(); }
+    size_t PooledBytes() const
+    {
+        size_t bytes = 0;
+        for (const PooledTexture &texture : pool)
+            bytes += size_t(texture.width) * texture.height * texture.samples * bytesPerPixel(texture.format);
+        return bytes;
+    }
+
+    // deletes every pooled texture and framebuffer
+    void Delete()
+    {
+        for (PooledTexture &texture : pool)
+            glDeleteTextures(1, &texture.texture);
+        pool.clear();
+        deleteFramebuffers();
+        for (ResourceNode &resource : resources)
+            resource.texture = 0;
+    }
+
+private:
+    struct ResourceNode {
+        std::string name;
+        GLenum format;
+        float scale;
+        unsigned int samples = 1;
+        bool unscaled = false;        // always rendered in full
+        unsigned int texture = 0;
+        size_t first = 0, last = 0;   // first and last pass that uses it
+        bool needed = false;          // read by a pass that is kept
+    };
+
+    struct Pass {
+        std::string name;
+        const char *zoneName = nullptr;  // name interned for the profiler
+        std::function<void()> execute;
+        vector<Resource> reads;
+        vector<Resource> colors;
+        vector<bool> clearColors;
+        Resource depth = BACKBUFFER;  // BACKBUFFER: no depth attachment
+        GpuTimer *timer = nullptr;
+        bool sideEffect = false;
+        bool culled = false;
+        vector<Resource> used;        // reads and attachments that are kept
+    };
+
+    struct PooledTexture {
+        unsigned int texture;
+        GLenum format;
+        unsigned int width, height, samples;
+        bool inUse;
+        unsigned long lastFrame;
+    };
+
+    unsigned int width, height;
+    float renderScale;
+    unsigned long frame;
+    unsigned int backbuffer;
+    vector<ResourceNode> resources;
+    vector<Pass> passes;
+    vector<PooledTexture> pool;
+    // attachment textures (colors, then depth) -> framebuffer
+    std::map<vector<unsigned int>, unsigned int> framebuffers;
+    vector<GpuTimer*> timers;
+    // pass name -> interned profiler zone name. The passes are declared again every frame, so this saves taking the
+    // profiler's intern lock once per pass and frame.
+    std::unordered_map<std::string, const char*> zoneNames;
+
+    const char *zoneName(const std::string &name)
+    {
+        auto found = zoneNames.find(name);
+        if (found != zoneNames.end())
+            return found->second;
+        const char *interned = CpuProfiler::Intern(name);
+        zoneNames.emplace(name, interned);
+        return interned;
+    }
+
+    glm::ivec2 allocatedSize(const ResourceNode &resource) const
+    {
+        return glm::ivec2(std::max(1, int(std::lround(width * resource.scale))), std::max(1, int(std::lround(height * resource.scale))));
+    }
+
+    // walks the passes backwards: a pass is kept if it has a side effect or writes a resource a kept pass after it
+    // reads or depth tests against
+    void cull()
+    {
+        for (ResourceNode &resource : resources)
+            resource.needed = false;
+        resources[BACKBUFFER].needed = true;
+        for (size_t i = passes.size(); i-- > 0;)
+        {
+            Pass &pass = passes[i];
+            bool keep = pass.sideEffect;
+            for (Resource resource : pass.colors)
+                keep = keep || resources[resource].needed;
+            if (pass.depth != BACKBUFFER)
+                keep = keep || resources[pass.depth].needed;
+            pass.culled = !keep;
+            if (pass.culled)
+                continue;
+            for (Resource resource : pass.reads)
+                resources[resource].needed = true;
+            // the depth buffer is an input of the depth test as well
+            if (pass.depth != BACKBUFFER)
+                resources[pass.depth].needed = true;
+        }
+    }
+
+    void computeLifetimes()
+    {
+        for (size_t i = 0; i < passes.size(); i++)
+        {
+            Pass &pass = passes[i];
+            pass.used.clear();
+            if (pass.culled)
+                continue;
+            for (Resource resource : pass.reads)
+                pass.used.push_back(resource);
+            for (Resource resource : pass.colors)
+                if (resources[resource].needed && resource != BACKBUFFER)
+                    pass.used.push_back(resource);
+            if (pass.depth != BACKBUFFER)
+                pass.used.push_back(pass.depth);
+            std::sort(pass.used.begin(), pass.used.end());
+            pass.used.erase(std::unique(pass.used.begin(), pass.used.end()), pass.used.end());
+        }
+        vector<bool> seen(resources.size(), false);
+        for (size_t i = 0; i < passes.size(); i++)
+        {
+            for (Resource resource : passes[i].used)
+            {
+                if (!seen[resource])
+                    resources[resource].first = i;
+                seen[resource] = true;
+                resources[resource].last = i;
+            }
+        }
+    }
+
+    void acquire(ResourceNode &resource)
+    {
+        glm::ivec2 size = allocatedSize(resource);
+        for (PooledTexture &texture : pool)
+        {
+            if (!texture.inUse && texture.format == resource.format && int(texture.width) == size.x && int(texture.height) == size.y &&
+                texture.samples == resource.samples)
+            {
+                texture.inUse = true;
+                texture.lastFrame = frame;
+                resource.texture = texture.texture;
+                return;
+            }
+        }
+        PooledTexture texture;
+        texture.format = resource.format;
+        texture.width = size.x;
+        texture.height = size.y;
+        texture.samples = resource.samples;
+        texture.inUse = true;
+        texture.lastFrame = frame;
+        texture.texture = createTexture(resource.format, size.x, size.y, resource.samples);
+        pool.push_back(texture);
+        resource.texture = texture.texture;
+    }
+
+    void release(ResourceNode &resource)
+    {
+        for (PooledTexture &texture : pool)
+            if (texture.texture == resource.texture)
+                texture.inUse = false;
+    }
+
+    void evict()
+    {
+        size_t kept = 0;
+        bool evicted = false;
+        for (PooledTexture &texture : pool)
+        {
+            if (frame - texture.lastFrame > EVICT_FRAMES)
+            {
+                glDeleteTextures(1, &texture.texture);
+                evicted = true;
+            }
+            else
+            {
+                pool[kept++] = texture;
+            }
+        }
+        pool.resize(kept);
+        // framebuffers are cheap to rebuild, it's not worth finding the ones that referenced the deleted textures
+        if (evicted)
+            deleteFramebuffers();
+    }
+
+    void deleteFramebuffers()
+    {
+        for (auto &framebuffer : framebuffers)
+            glDeleteFramebuffers(1, &framebuffer.second);
+        framebuffers.clear();
+    }
+
+    // binds the framebuffer of the pass, clears the targets it writes first and sets the viewport
+    void bindTargets(size_t passIndex)
+    {
+        const Pass &pass = passes[passIndex];
+        bool toBackbuffer = false;
+        for (Resource resource : pass.colors)
+            toBackbuffer = toBackbuffer || resource == BACKBUFFER;
+        if (toBackbuffer)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, backbuffer);
+            glViewport(0, 0, width, height);
+            return;
+        }
+        if (pass.colors.empty() && pass.depth == BACKBUFFER)
+            return;
+
+        // dropped outputs keep their slot so the fragment output locations still line up
+        vector<unsigned int> key;
+        for (Resource resource : pass.colors)
+            key.push_back(resources[resource].needed ? resources[resource].texture : 0);
+        key.push_back(pass.depth != BACKBUFFER ? resources[pass.depth].texture : 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebufferFor(key));
+
+        Resource sizeFrom = pass.depth;
+        for (size_t slot = 0; slot < pass.colors.size(); slot++)
+        {
+            Resource resource = pass.colors[slot];
+            if (!resources[resource].needed)
+                continue;
+            sizeFrom = resource;
+            if (pass.clearColors[slot] && resources[resource].first == passIndex)
+            {
+                const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                glClearBufferfv(GL_COLOR, slot, zero);
+            }
+        }
+        if (pass.depth != BACKBUFFER && resources[pass.depth].first == passIndex)
+        {
+            const GLfloat one = 1.0f;
+            glDepthMask(GL_TRUE);
+            glClearBufferfv(GL_DEPTH, 0, &one);
+        }
+        glm::ivec2 region = Region(sizeFrom);
+        glViewport(0, 0, region.x, region.y);
+    }
+
+    unsigned int framebufferFor(const vector<unsigned int> &key)
+    {
+        auto it = framebuffers.find(key);
+        if (it == framebuffers.end())
+            it = framebuffers.emplace(key, createFramebuffer(key)).first;
+        return it->second;
+    }
+
+    // runs inside the blit pass. Looking up the framebuffers may create one, which changes the bindings, so both are
+    // bound again.
+    void blit(Resource source, Resource target)
+    {
+        unsigned int read = framebufferFor({ resources[source].texture, 0 });
+        unsigned int draw = framebufferFor({ resources[target].texture, 0 });
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw);
+        glm::ivec2 from = Region(source), to = Region(target);
+        // a resolve has to be 1:1, scaling blits of multisampled sources are an error
+        glBlitFramebuffer(0, 0, from.x, from.y, 0, 0, to.x, to.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+
+    GLenum textureTarget(unsigned int texture) const
+    {
+        for (const PooledTexture &pooled : pool)
+            if (pooled.texture == texture)
+                return pooled.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+        return GL_TEXTURE_2D;
+    }
+
+    unsigned int createFramebuffer(const vector<unsigned int> &key)
+    {
+        unsigned int FBO;
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        vector<GLenum> drawBuffers;
+        bool anyColor = false;
+        for (size_t slot = 0; slot + 1 < key.size(); slot++)
+        {
+            if (key[slot])
+            {
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + slot, textureTarget(key[slot]), key[slot], 0);
+                drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + slot);
+                anyColor = true;
+            }
+            else
+            {
+                drawBuffers.push_back(GL_NONE);
+            }
+        }
+        if (key.back())
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textureTarget(key.back()), key.back(), 0);
+        if (anyColor)
+        {
+            glDrawBuffers(drawBuffers.size(), drawBuffers.data());
+        }
+        else
+        {
+            // depth only, a 3.3 context wants no draw or read buffer then
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        }
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::RENDER_GRAPH:: Framebuffer not complete!" << std::endl;
+        return FBO;
+    }
+
+    static bool isDepthFormat(GLenum format)
+    {
+        return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F;
+    }
+
+    static unsigned int bytesPerPixel(GLenum format)
+    {
+        switch (format)
+        {
+            case GL_R8: return 1;
+            case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+            case GL_RGBA16F: return 8;
+            case GL_RGBA32F: return 16;
+            default: return 4;   // RGBA8, RG16, RG16F, R11F_G11F_B10F, DEPTH_COMPONENT24/32F
+        }
+    }
+
+    static unsigned int createTexture(GLenum internalFormat, int width, int height, unsigned int samples)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        if (samples > 1)
+        {
+            // only ever attached and resolved, multisample textures have no sampler state
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture);
+            glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, internalFormat, width, height, GL_TRUE);
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+            return texture;
+        }
+
+        GLenum format = GL_RGBA, type = GL_UNSIGNED_BYTE;
+        switch (internalFormat)
+        {
+            case GL_RGBA16F: case GL_RGBA32F: format = GL_RGBA; type = GL_FLOAT; break;
+            case GL_R11F_G11F_B10F: format = GL_RGB; type = GL_FLOAT; break;
+            case GL_RG16F: format = GL_RG; type = GL_FLOAT; break;
+            case GL_R16F: format = GL_RED; type = GL_FLOAT; break;
+            case GL_RG16: format = GL_RG; type = GL_UNSIGNED_SHORT; break;
+            case GL_RG8: format = GL_RG; break;
+            case GL_R8: format = GL_RED; break;
+            case GL_DEPTH_COMPONENT16: case GL_DEPTH_COMPONENT24: format = GL_DEPTH_COMPONENT; type = GL_UNSIGNED_INT; break;
+            case GL_DEPTH_COMPONENT32F: format = GL_DEPTH_COMPONENT; type = GL_FLOAT; break;
+            default: break;
+        }
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+        // depth is read texel by texel, color targets are filtered by the resampling passes (bloom, upscale)
+        GLint filter = isDepthFormat(internalFormat) ? GL_NEAREST : GL_LINEAR;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+};
+#endif
@@ -4,105 +4,182 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <common.h>
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/cpu_profiler.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+// FNV-1a hash of a uniform name, usable at compile time for string literals
+constexpr uint64_t UniformHash(const char *name)
+{
+    uint64_t hash = 14695981039346656037ull;
+    while (*name)
+    {
+        hash ^= (unsigned char)*name++;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// optional parts of a shader, compiled in with #define <name> (see ShaderFeatureDefines and ShaderVariants)
+enum ShaderFeature : unsigned int {
+    SHADER_FEATURE_SPECULAR_MAP = 1 << 0,   // HAS_SPECULAR_MAP: samples material.texture_specular1
+    SHADER_FEATURE_NORMAL_MAP   = 1 << 1,   // HAS_NORMAL_MAP: perturbs the normal with material.texture_normal1
+    SHADER_FEATURE_INSTANCED    = 1 << 2,   // INSTANCED: model matrix from the instance attribute (InstanceBuffer)
+    SHADER_FEATURE_ALL          = (1 << 3) - 1
+};
+
+inline std::string ShaderFeatureDefines(unsigned int features)
+{
+    static const char *names[] = { "HAS_SPECULAR_MAP", "HAS_NORMAL_MAP", "INSTANCED" };
+    std::string defines;
+    for (unsigned int bit = 0; bit < sizeof(names) / sizeof(names[0]); bit++)
+        if (features & (1u << bit))
+            defines += std::string("#define ") + names[bit] + "\n";
+    return defines;
+}
+
+// typed reference to a uniform by the hash of its name. Handles do not belong to a program, the same handle works
+// with every shader that declares the uniform; hot paths keep them in (constexpr) variables:
+//
+//     static constexpr UniformHandle<glm::mat4> MODEL("model");
+//     shader.set(MODEL, model);
+template <typename T>
+struct UniformHandle {
+    uint64_t hash;
+    constexpr explicit UniformHandle(const char *name) : hash(UniformHash(name)) {}
+    explicit UniformHandle(const std::string &name) : hash(UniformHash(name.c_str())) {}
+};
+
+// upload function and accepted GLSL types per C++ type
+template <typename T> struct UniformTraits;
+template <> struct UniformTraits<int> {
+    static void upload(GLint location, const int &value) { glUniform1i(location, value); }
+    static bool accepts(GLenum type) { return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_SAMPLER_CUBE ||
+                                              type == GL_SAMPLER_BUFFER || type == GL_INT_SAMPLER_BUFFER || type == GL_UNSIGNED_INT_SAMPLER_BUFFER ||
+                                              type == GL_SAMPLER_2D_ARRAY || type == GL_SAMPLER_2D_SHADOW || type == GL_SAMPLER_2D_MULTISAMPLE; }
+};
+template <> struct UniformTraits<float> {
+    static void upload(GLint location, const float &value) { glUniform1f(location, value); }
+    static bool accepts(GLenum type) { return type == GL_FLOAT; }
+};
+template <> struct UniformTraits<glm::vec2> {
+    static void upload(GLint location, const glm::vec2 &value) { glUniform2fv(location, 1, &value[0]); }
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC2; }
+};
+template <> struct UniformTraits<glm::vec3> {
+    static void upload(GLint location, const glm::vec3 &value) { glUniform3fv(location, 1, &value[0]); }
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC3; }
+};
+template <> struct UniformTraits<glm::vec4> {
+    static void upload(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, &value[0]); }
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC4; }
+};
+template <> struct UniformTraits<glm::mat2> {
+    static void upload(GLint location, const glm::mat2 &value) { glUniformMatrix2fv(location, 1, GL_FALSE, &value[0][0]); }
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT2; }
+};
+template <> struct UniformTraits<glm::mat3> {
+    static void upload(GLint location, const glm::mat3 &value) { glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]); }
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT3; }
+};
+template <> struct UniformTraits<glm::mat4> {
+    static void upload(GLint location, const glm::mat4 &value) { glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]); }
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT4; }
+};
+
+class ShaderBatch;
+
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor generates the shader on the fly. The sources are run through Preprocess, defines (e.g. from
+    // ShaderFeatureDefines) is inserted after the #version line of every stage. Linked programs are kept in the
+    // ProgramCache, later runs load the binary instead of compiling.
+    //
+    // Without a batch the constructor waits for the driver and the program is ready to use. With a batch it only
+    // submits the compile and link, the program is usable once the batch finished it (ShaderBatch::Poll/Finish).
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::string &defines = "",
+           ShaderBatch *batch = nullptr);
+
+    // whether the driver is done with the program. Never waits; without KHR_parallel_shader_compile the driver
+    // cannot be asked, only finished programs report true then.
+    bool IsCompiled() const
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
+        if (finished)
+            return true;
+        if (!GLExt().parallelShaderCompile)
+            return false;
+        GLint complete = GL_FALSE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
 
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
+    // checks the compile and link results, reports errors, stores the binary and reflects the uniforms. Waits for
+    // the driver if it is still compiling. Nothing else queries the program before, so the driver is free to compile
+    // in the background until here.
+    void Finish()
+    {
+        if (finished)
+            return;
+        finished = true;
+        if (!cached)
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
+            static const char *stageNames[3] = { "VERTEX", "FRAGMENT", "GEOMETRY" };
+            for (unsigned int i = 0; i < 3; i++)
             {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
+                if (!stages[i])
+                    continue;
+                if (!checkCompileErrors(stages[i], stageNames[i]))
+                {
+                    // the source string numbers in the log refer to these files
+                    for (unsigned int file = 0; file < stageFiles[i].size(); file++)
+                        std::cout << "  " << file << ": " << stageFiles[i][file] << std::endl;
+                }
             }
+            if (checkCompileErrors(ID, "PROGRAM"))
+                ProgramCache::Store(ID, cacheKey);
+            // delete the shaders as they're linked into our program now and no longer necessery
+            for (unsigned int i = 0; i < 3; i++)
+                if (stages[i])
+                    glDeleteShader(stages[i]);
         }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
+        for (unsigned int i = 0; i < 3; i++)
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            stages[i] = 0;
+            stageFiles[i].clear();
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
+        reflectUniforms();
+    }
 
+    // reads a shader source and expands
+    //
+    //     #include "file"      relative to the including file, every file is included once per stage
+    //
+    // defines is inserted right after the #version line. #line directives keep compiler messages pointing at the
+    // right line, their source string number is the index of the file in files.
+    static std::string Preprocess(const std::string &path, const std::string &defines, std::vector<std::string> &files)
+    {
+        std::string result;
+        appendSource(path, defines, files, result);
+        return result;
     }
+
+    // programs are referenced by ID all over the place, copying one would share it
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
@@ -110,68 +187,297 @@ public:
         glUseProgram(ID); 
     }
     // utility uniform functions
+    // the program has to be bound (use). Values that equal the last value set through this object are not uploaded
+    // again, names the program does not use are ignored.
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
-    {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    template <typename T>
+    void set(UniformHandle<T> handle, const T &value) const
+    {
+        Uniform *uniform = find(handle.hash);
+        if (!uniform)
+            return;
+        if (!UniformTraits<T>::accepts(uniform->type))
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH: " << uniform->name << std::endl;
+            return;
+        }
+        static_assert(sizeof(T) <= sizeof(uniform->value), "uniform value does not fit the cache");
+        if (uniform->cached && memcmp(uniform->value, &value, sizeof(T)) == 0)
+            return;
+        memcpy(uniform->value, &value, sizeof(T));
+        uniform->cached = true;
+        UniformTraits<T>::upload(uniform->location, value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
-    { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    void setBool(const char *name, bool value) const
+    {
+        set(UniformHandle<int>(name), (int)value);
     }
+    void setBool(const std::string &name, bool value) const { setBool(name.c_str(), value); }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
-    { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    void setInt(const char *name, int value) const
+    {
+        set(UniformHandle<int>(name), value);
     }
+    void setInt(const std::string &name, int value) const { setInt(name.c_str(), value); }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
-    { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    void setFloat(const char *name, float value) const
+    {
+        set(UniformHandle<float>(name), value);
     }
-    void setVec2(const std::string &name, float x, float y) const
-    { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+    void setFloat(const std::string &name, float value) const { setFloat(name.c_str(), value); }
+    // ------------------------------------------------------------------------
+    void setVec2(const char *name, const glm::vec2 &value) const
+    {
+        set(UniformHandle<glm::vec2>(name), value);
+    }
+    void setVec2(const std::string &name, const glm::vec2 &value) const { setVec2(name.c_str(), value); }
+    void setVec2(const char *name, float x, float y) const
+    {
+        setVec2(name, glm::vec2(x, y));
     }
+    void setVec2(const std::string &name, float x, float y) const { setVec2(name.c_str(), glm::vec2(x, y)); }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
-    { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    void setVec3(const char *name, const glm::vec3 &value) const
+    {
+        set(UniformHandle<glm::vec3>(name), value);
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
-    { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+    void setVec3(const std::string &name, const glm::vec3 &value) const { setVec3(name.c_str(), value); }
+    void setVec3(const char *name, float x, float y, float z) const
+    {
+        setVec3(name, glm::vec3(x, y, z));
     }
+    void setVec3(const std::string &name, float x, float y, float z) const { setVec3(name.c_str(), glm::vec3(x, y, z)); }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
-    { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    void setVec4(const char *name, const glm::vec4 &value) const
+    {
+        set(UniformHandle<glm::vec4>(name), value);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) 
-    { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+    void setVec4(const std::string &name, const glm::vec4 &value) const { setVec4(name.c_str(), value); }
+    void setVec4(const char *name, float x, float y, float z, float w) const
+    {
+        setVec4(name, glm::vec4(x, y, z, w));
     }
+    void setVec4(const std::string &name, float x, float y, float z, float w) const { setVec4(name.c_str(), glm::vec4(x, y, z, w)); }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(UniformHandle<glm::mat2>(name), mat);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(UniformHandle<glm::mat3>(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    void setMat4(const char *name, const glm::mat4 &mat) const
+    {
+        set(UniformHandle<glm::mat4>(name), mat);
+    }
+    void setMat4(const std::string &name, const glm::mat4 &mat) const { setMat4(name.c_str(), mat); }
+
+    // attaches the program's uniform block of that name to a binding point (see UniformBlock), returns false
+    // if the program has no such block
+    bool bindUniformBlock(const char *name, GLuint binding) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLuint index = glGetUniformBlockIndex(ID, name);
+        if (index == GL_INVALID_INDEX)
+            return false;
+        glUniformBlockBinding(ID, index, binding);
+        return true;
+    }
+
+    // whether the program has an active uniform of that name
+    bool hasUniform(const std::string &name) const
+    {
+        return find(UniformHash(name.c_str())) != nullptr;
     }
 
 private:
+    // compile state between the constructor and Finish
+    bool finished = false;
+    bool cached = false;
+    uint64_t cacheKey = 0;
+    unsigned int stages[3] = { 0, 0, 0 };
+    std::vector<std::string> stageFiles[3];
+
+    // submits compile and link without asking for any result, asking would wait for the compiler
+    void submit(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const std::string &defines)
+    {
+        // 1. retrieve the vertex/fragment source code from filePath, resolving includes
+        std::string vertexCode = Preprocess(vertexPath, defines, stageFiles[0]);
+        std::string fragmentCode = Preprocess(fragmentPath, defines, stageFiles[1]);
+        std::string geometryCode;
+        if(geometryPath != nullptr)
+            geometryCode = Preprocess(geometryPath, defines, stageFiles[2]);
+        // 2. reuse the binary of an earlier run if the driver still accepts it
+        ID = glCreateProgram();
+        cacheKey = ProgramCache::Key(vertexCode, fragmentCode, geometryCode);
+        if (ProgramCache::Load(ID, cacheKey))
+        {
+            cached = true;
+            return;
+        }
+        // the failed load left the program in an undefined state, start over with a fresh one
+        glDeleteProgram(ID);
+        ID = glCreateProgram();
+        // 3. compile shaders
+        stages[0] = createStage(GL_VERTEX_SHADER, vertexCode);
+        stages[1] = createStage(GL_FRAGMENT_SHADER, fragmentCode);
+        // if geometry shader is given, compile geometry shader
+        if(geometryPath != nullptr)
+            stages[2] = createStage(GL_GEOMETRY_SHADER, geometryCode);
+        // shader Program
+        for (unsigned int i = 0; i < 3; i++)
+            if (stages[i])
+                glAttachShader(ID, stages[i]);
+        ProgramCache::PrepareLink(ID);
+        glLinkProgram(ID);
+    }
+
+    // an active uniform of the program, reflected once after linking
+    struct Uniform {
+        std::string name;
+        GLint location;
+        GLenum type;
+        bool cached = false;
+        unsigned char value[64]; // last uploaded value, large enough for a mat4
+    };
+    // mutable: the const setters update the value cache
+    mutable std::vector<Uniform> uniforms;
+    // open addressing table from name hash to index into uniforms, power of two sized, hash 0 marks a free slot
+    std::vector<uint64_t> tableHashes;
+    std::vector<unsigned int> tableIndices;
+
+    Uniform *find(uint64_t hash) const
+    {
+        if (tableHashes.empty())
+            return nullptr;
+        size_t mask = tableHashes.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+        {
+            if (tableHashes[slot] == hash)
+                return &uniforms[tableIndices[slot]];
+            if (tableHashes[slot] == 0)
+                return nullptr;
+        }
+    }
+
+    void insert(const std::string &name, GLint location, GLenum type)
+    {
+        Uniform uniform;
+        uniform.name = name;
+        uniform.location = location;
+        uniform.type = type;
+        uniforms.push_back(uniform);
+    }
+
+    // queries every active uniform. Arrays are registered under "name", "name[0]" and every "name[i]".
+    void reflectUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size = 0;
+            GLenum type = 0;
+            GLsizei length = 0;
+            glGetActiveUniform(ID, i, buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            GLint location = glGetUniformLocation(ID, name.c_str());
+            // uniforms in blocks have no location, they are set through their buffer
+            if (location < 0)
+                continue;
+            insert(name, location, type);
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            {
+                std::string base = name.substr(0, name.size() - 3);
+                insert(base, location, type);
+                for (GLint element = 1; element < size; element++)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    insert(elementName, glGetUniformLocation(ID, elementName.c_str()), type);
+                }
+            }
+        }
+
+        size_t capacity = 16;
+        while (capacity < uniforms.size() * 2)
+            capacity *= 2;
+        tableHashes.assign(capacity, 0);
+        tableIndices.assign(capacity, 0);
+        size_t mask = capacity - 1;
+        for (unsigned int i = 0; i < uniforms.size(); i++)
+        {
+            uint64_t hash = UniformHash(uniforms[i].name.c_str());
+            size_t slot = hash & mask;
+            while (tableHashes[slot] != 0)
+                slot = (slot + 1) & mask;
+            tableHashes[slot] = hash;
+            tableIndices[slot] = i;
+        }
+    }
+
+    static void appendSource(const std::string &path, const std::string &defines, std::vector<std::string> &files,
+                             std::string &result)
+    {
+        for (const std::string &file : files)
+            if (file == path)
+                return;
+        unsigned int fileIndex = files.size();
+        files.push_back(path);
+
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+            return;
+        }
+        std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+        if (fileIndex > 0)
+            result += "#line 1 " + std::to_string(fileIndex) + "\n";
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            lineNumber++;
+            size_t start = line.find_first_not_of(" \t");
+            if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+            {
+                size_t open = line.find('"', start + 8);
+                size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+                if (close == std::string::npos)
+                {
+                    std::cout << "ERROR::SHADER::MALFORMED_INCLUDE: " << path << ":" << lineNumber << std::endl;
+                    continue;
+                }
+                appendSource(directory + line.substr(open + 1, close - open - 1), defines, files, result);
+                result += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+                continue;
+            }
+            result += line + "\n";
+            if (fileIndex == 0 && start != std::string::npos && line.compare(start, 8, "#version") == 0 && !defines.empty())
+            {
+                result += defines;
+                result += "#line " + std::to_string(lineNumber + 1) + " 0\n";
+            }
+        }
+    }
+
+    static unsigned int createStage(GLenum type, const std::string &code)
+    {
+        const char *source = code.c_str();
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        return shader;
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -193,6 +499,161 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
+
+// programs compiled side by side: every program of the batch is submitted first, the driver compiles them on its
+// own threads (KHR_parallel_shader_compile) while the caller keeps loading assets, and nobody asks for a result
+// before the driver reports completion.
+//
+//     ShaderBatch batch;
+//     Shader a("a.vs", "a.fs", nullptr, "", &batch);
+//     Shader b("b.vs", "b.fs", nullptr, "", &batch);
+//     ... load models ...
+//     batch.Finish();    // a and b are usable from here on
+//
+// The shaders must stay in place until the batch finished them.
+class ShaderBatch
+{
+public:
+    ShaderBatch() = default;
+    ShaderBatch(const ShaderBatch&) = delete;
+    ShaderBatch& operator=(const ShaderBatch&) = delete;
+
+    void Add(Shader *shader) { pending.push_back(shader); }
+
+    // finishes the programs the driver is done with, returns true once none is left. Never waits with
+    // KHR_parallel_shader_compile; without it completion cannot be queried and one program is finished per call,
+    // so a loading screen still gets frames in between.
+    bool Poll()
+    {
+        size_t kept = 0;
+        for (Shader *shader : pending)
+        {
+            if (shader->IsCompiled())
+                shader->Finish();
+            else
+                pending[kept++] = shader;
+        }
+        pending.resize(kept);
+        if (!GLExt().parallelShaderCompile && !pending.empty())
+        {
+            pending.front()->Finish();
+            pending.erase(pending.begin());
+        }
+        return pending.empty();
+    }
+
+    // finishes every program, waiting for the driver where necessary
+    void Finish()
+    {
+        PROFILE_ZONE("ShaderBatch::Finish");
+        for (Shader *shader : pending)
+            shader->Finish();
+        pending.clear();
+    }
+
+    size_t Pending() const { return pending.size(); }
+
+private:
+    std::vector<Shader*> pending;
+};
+
+inline Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const std::string &defines,
+                      ShaderBatch *batch)
+{
+    submit(vertexPath, fragmentPath, geometryPath, defines);
+    if (batch)
+        batch->Add(this);
+    else
+        Finish();
+}
+
+// the programs built from one pair of sources for the feature sets that are actually drawn with. Variants are
+// compiled on first use, or ahead of it in a ShaderBatch (Prepare), and cached by their feature bitmask, features outside the mask given to the constructor are
+// ignored, so e.g. a depth-only program shares one variant between meshes with and without specular maps.
+class ShaderVariants
+{
+public:
+    // called with the variant bound: onCreate once after it is built (uniform block bindings, constant uniforms),
+    // onFrame before its first use in every frame (per-frame uniforms and textures, see NextFrame)
+    std::function<void(Shader&)> onCreate;
+    std::function<void(Shader&)> onFrame;
+
+    ShaderVariants(std::string vertexPath, std::string fragmentPath, unsigned int usedFeatures = SHADER_FEATURE_ALL)
+        : vertexPath(std::move(vertexPath)), fragmentPath(std::move(fragmentPath)), usedFeatures(usedFeatures), frame(1)
+    {
+    }
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+    // submits the variant for features to the batch unless it exists already, so it compiles before its first use
+    void Prepare(unsigned int features, ShaderBatch &batch)
+    {
+        features &= usedFeatures;
+        if (variants.find(features) == variants.end())
+            variants.emplace(features, build(features, &batch));
+    }
+
+    // binds the variant for features, building it first if needed
+    Shader &Use(unsigned int features)
+    {
+        features &= usedFeatures;
+        auto it = variants.find(features);
+        if (it == variants.end())
+            it = variants.emplace(features, build(features, nullptr)).first;
+        Variant &variant = it->second;
+        if (!variant.created)
+        {
+            // a prepared variant the batch has not finished yet waits for the driver here
+            variant.shader->Finish();
+            variant.shader->use();
+            if (onCreate)
+                onCreate(*variant.shader);
+            variant.created = true;
+        }
+        variant.shader->use();
+        if (variant.frame != frame)
+        {
+            variant.frame = frame;
+            if (onFrame)
+                onFrame(*variant.shader);
+        }
+        return *variant.shader;
+    }
+
+    // starts a new frame, every variant gets onFrame again before it is used next
+    void NextFrame() { frame++; }
+
+    size_t Count() const { return variants.size(); }
+
+    void Delete()
+    {
+        for (auto &variant : variants)
+            glDeleteProgram(variant.second.shader->ID);
+        variants.clear();
+    }
+
+private:
+    struct Variant {
+        std::unique_ptr<Shader> shader;
+        bool created = false; // onCreate ran
+        unsigned long frame = 0;
+    };
+
+    Variant build(unsigned int features, ShaderBatch *batch) const
+    {
+        Variant variant;
+        variant.shader.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(), nullptr, ShaderFeatureDefines(features), batch));
+        return variant;
+    }
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    unsigned int usedFeatures;
+    unsigned long frame;
+    std::map<unsigned int, Variant> variants;
+};
 #endif
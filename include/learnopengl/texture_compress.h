@@ -0,0 +1,312 @@
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// Simple cpu block compressors used by the offline texture cooker (tools/texture_cooker.cpp).
+// They favour speed and simplicity over the last bit of quality: endpoints come from the block's bounding box
+// (oriented along the dominant color correlation) and every texel picks its nearest palette entry.
+// All functions read 8-bit RGBA images and write the blocks in row-major block order.
+
+enum class BlockFormat {
+    BC1,    // RGB, 4 bpp
+    BC3,    // RGBA with interpolated alpha, 8 bpp
+    BC4,    // single channel (red), 4 bpp
+    BC5,    // two channels (red, green), 8 bpp, used for tangent space normal maps
+    BC7     // RGBA, 8 bpp, mode 6 only
+};
+
+inline unsigned int BlockBytes(BlockFormat format)
+{
+    return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+}
+
+inline size_t CompressedSize(BlockFormat format, int width, int height)
+{
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+namespace block_compress {
+
+// 4x4 texels of a block, edge texels are replicated for images that are not a multiple of 4
+inline void fetchBlock(const unsigned char *rgba, int width, int height, int bx, int by, unsigned char block[16][4])
+{
+    for (int y = 0; y < 4; y++)
+    {
+        int sy = std::min(by * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++)
+        {
+            int sx = std::min(bx * 4 + x, width - 1);
+            memcpy(block[y * 4 + x], rgba + (size_t(sy) * width + sx) * 4, 4);
+        }
+    }
+}
+
+inline uint16_t to565(int r, int g, int b)
+{
+    return uint16_t(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+}
+
+inline void from565(uint16_t c, int rgb[3])
+{
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// color part of BC1/BC3, always in four color mode
+inline void encodeColor(const unsigned char block[16][4], unsigned char *out)
+{
+    int minC[3] = {255, 255, 255}, maxC[3] = {0, 0, 0};
+    float mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            minC[c] = std::min(minC[c], int(block[i][c]));
+            maxC[c] = std::max(maxC[c], int(block[i][c]));
+            mean[c] += block[i][c] / 16.0f;
+        }
+    }
+    // orient the bounding box diagonal along the correlation of red and blue with green
+    float covRG = 0, covBG = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        float g = block[i][1] - mean[1];
+        covRG += (block[i][0] - mean[0]) * g;
+        covBG += (block[i][2] - mean[2]) * g;
+    }
+    if (covRG < 0)
+        std::swap(minC[0], maxC[0]);
+    if (covBG < 0)
+        std::swap(minC[2], maxC[2]);
+
+    uint16_t c0 = to565(maxC[0], maxC[1], maxC[2]);
+    uint16_t c1 = to565(minC[0], minC[1], minC[2]);
+    uint32_t indices = 0;
+    if (c0 < c1)
+        std::swap(c0, c1);
+    if (c0 != c1)
+    {
+        int palette[4][3];
+        from565(c0, palette[0]);
+        from565(c1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; c++)
+                    error += (block[i][c] - palette[p][c]) * (block[i][c] - palette[p][c]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= uint32_t(best) << (2 * i);
+        }
+    }
+    memcpy(out, &c0, 2);
+    memcpy(out + 2, &c1, 2);
+    memcpy(out + 4, &indices, 4);
+}
+
+// BC4 block of a single channel, also the alpha part of BC3 and each half of BC5
+inline void encodeChannel(const unsigned char block[16][4], int channel, unsigned char *out)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, int(block[i][channel]));
+        a1 = std::min(a1, int(block[i][channel]));
+    }
+    uint64_t bits = 0;
+    if (a0 != a1)
+    {
+        // a0 > a1 selects the eight value mode, palette index 0 = a0, 1 = a1, 2..7 interpolate from a0 to a1
+        int palette[8] = {a0, a1};
+        for (int p = 1; p < 7; p++)
+            palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 8; p++)
+            {
+                int error = std::abs(int(block[i][channel]) - palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            bits |= uint64_t(best) << (3 * i);
+        }
+    }
+    out[0] = uint8_t(a0);
+    out[1] = uint8_t(a1);
+    for (int b = 0; b < 6; b++)
+        out[2 + b] = uint8_t(bits >> (8 * b));
+}
+
+// writes count bits of value at bit position pos of a 128 bit block
+inline void putBits(unsigned char *out, int &pos, uint32_t value, int count)
+{
+    for (int i = 0; i < count; i++, pos++)
+    {
+        if (value & (1u << i))
+            out[pos >> 3] |= uint8_t(1u << (pos & 7));
+    }
+}
+
+// BC7 mode 6: one subset, RGBA endpoints with 7 bits per channel plus a shared p-bit, 4 bit indices
+inline void encodeBC7(const unsigned char block[16][4], unsigned char *out)
+{
+    static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    int lo[4] = {255, 255, 255, 255}, hi[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            lo[c] = std::min(lo[c], int(block[i][c]));
+            hi[c] = std::max(hi[c], int(block[i][c]));
+        }
+    }
+    // quantize to 7 bits + p-bit; the p-bit is picked per endpoint from the parity the channels prefer
+    int endpoints[2][4], pbits[2];
+    const int *source[2] = {lo, hi};
+    for (int e = 0; e < 2; e++)
+    {
+        int odd = 0;
+        for (int c = 0; c < 4; c++)
+            odd += source[e][c] & 1;
+        pbits[e] = odd >= 2 ? 1 : 0;
+        for (int c = 0; c < 4; c++)
+        {
+            int v = (source[e][c] - pbits[e] + 1) >> 1;
+            endpoints[e][c] = std::max(0, std::min(127, v));
+        }
+    }
+    int expanded[2][4];
+    for (int e = 0; e < 2; e++)
+        for (int c = 0; c < 4; c++)
+            expanded[e][c] = (endpoints[e][c] << 1) | pbits[e];
+
+    int indices[16];
+    for (int i = 0; i < 16; i++)
+    {
+        int best = 0, bestError = 1 << 30;
+        for (int w = 0; w < 16; w++)
+        {
+            int error = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                int v = (expanded[0][c] * (64 - weights[w]) + expanded[1][c] * weights[w] + 32) >> 6;
+                error += (block[i][c] - v) * (block[i][c] - v);
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                best = w;
+            }
+        }
+        indices[i] = best;
+    }
+    // the msb of the first index is implicit zero, swap the endpoints if it would be set
+    if (indices[0] >= 8)
+    {
+        for (int c = 0; c < 4; c++)
+            std::swap(endpoints[0][c], endpoints[1][c]);
+        std::swap(pbits[0], pbits[1]);
+        for (int i = 0; i < 16; i++)
+            indices[i] = 15 - indices[i];
+    }
+
+    memset(out, 0, 16);
+    int pos = 0;
+    putBits(out, pos, 1u << 6, 7); // mode 6
+    for (int c = 0; c < 4; c++)
+    {
+        putBits(out, pos, endpoints[0][c], 7);
+        putBits(out, pos, endpoints[1][c], 7);
+    }
+    putBits(out, pos, pbits[0], 1);
+    putBits(out, pos, pbits[1], 1);
+    putBits(out, pos, indices[0], 3);
+    for (int i = 1; i < 16; i++)
+        putBits(out, pos, indices[i], 4);
+}
+
+}
+
+// compresses a whole RGBA8 image
+inline vector<unsigned char> CompressImage(const unsigned char *rgba, int width, int height, BlockFormat format)
+{
+    vector<unsigned char> blocks(CompressedSize(format, width, height));
+    unsigned char *out = blocks.data();
+    unsigned char block[16][4];
+    for (int by = 0; by < (height + 3) / 4; by++)
+    {
+        for (int bx = 0; bx < (width + 3) / 4; bx++)
+        {
+            block_compress::fetchBlock(rgba, width, height, bx, by, block);
+            switch (format)
+            {
+                case BlockFormat::BC1:
+                    block_compress::encodeColor(block, out);
+                    break;
+                case BlockFormat::BC3:
+                    block_compress::encodeChannel(block, 3, out);
+                    block_compress::encodeColor(block, out + 8);
+                    break;
+                case BlockFormat::BC4:
+                    block_compress::encodeChannel(block, 0, out);
+                    break;
+                case BlockFormat::BC5:
+                    block_compress::encodeChannel(block, 0, out);
+                    block_compress::encodeChannel(block, 1, out + 8);
+                    break;
+                case BlockFormat::BC7:
+                    block_compress::encodeBC7(block, out);
+                    break;
+            }
+            out += BlockBytes(format);
+        }
+    }
+    return blocks;
+}
+
+// next smaller mip level of an RGBA8 image (2x2 box filter, odd edges are clamped)
+inline vector<unsigned char> DownsampleImage(const unsigned char *rgba, int width, int height, int &outWidth, int &outHeight)
+{
+    outWidth = std::max(1, width / 2);
+    outHeight = std::max(1, height / 2);
+    vector<unsigned char> result(size_t(outWidth) * outHeight * 4);
+    for (int y = 0; y < outHeight; y++)
+    {
+        int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < outWidth; x++)
+        {
+            int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = rgba[(size_t(y0) * width + x0) * 4 + c] + rgba[(size_t(y0) * width + x1) * 4 + c] +
+                          rgba[(size_t(y1) * width + x0) * 4 + c] + rgba[(size_t(y1) * width + x1) * 4 + c];
+                result[(size_t(y) * outWidth + x) * 4 + c] = uint8_t((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+#endif
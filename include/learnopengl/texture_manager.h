@@ -0,0 +1,212 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/texture_streamer.h>
+
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Process-wide, reference counted texture cache shared by all models and the scene textures.
+// A texture is found by its normalized path first and, for paths not seen before, by a hash of the file content,
+// so the same image shipped in several directories (e.g. internal_ground_ao_texture.jpeg) is decoded and uploaded once.
+// Textures are loaded through the active TextureStreamer, or synchronously if there is none.
+class TextureManager
+{
+public:
+    static TextureManager &Instance()
+    {
+        static TextureManager manager;
+        return manager;
+    }
+
+    // returns a texture for the image at path and takes a reference to it. contentHash may be passed if the caller
+    // has already hashed the file (e.g. on a loader thread), 0 makes the manager hash it when the path is new.
+    unsigned int Acquire2D(const string &path, bool clampTransparent = false, uint64_t contentHash = 0)
+    {
+        string key = NormalizePath(path) + (clampTransparent ? "|clamp" : "");
+        auto byPathIt = byPath.find(key);
+        if (byPathIt != byPath.end())
+            return addRef(byPathIt->second);
+
+        if (contentHash == 0 && !hashFile(path, contentHash))
+            contentHash = hashBytes((const unsigned char*)key.data(), key.size()); // missing file, load fails below
+        contentHash = hashBytes((const unsigned char*)&clampTransparent, sizeof(clampTransparent), contentHash);
+        auto byContentIt = byContent.find(contentHash);
+        if (byContentIt != byContent.end())
+        {
+            byPath[key] = byContentIt->second;
+            entries[byContentIt->second].keys.push_back(key);
+            return addRef(byContentIt->second);
+        }
+
+        unsigned int texture;
+        TextureStreamer *streamer = TextureStreamer::Active();
+        if (streamer)
+        {
+            texture = streamer->Load2D(path, clampTransparent);
+        }
+        else
+        {
+            glGenTextures(1, &texture);
+            vector<string> paths(1, path);
+            vector<TextureImage> images(1, LoadTextureImage(path));
+            TextureStreamer::UploadNow(texture, GL_TEXTURE_2D, paths, images, clampTransparent);
+            FreeTextureImage(images[0]);
+        }
+        return insert(texture, key, contentHash);
+    }
+
+    // returns a cubemap for the six faces (+X, -X, +Y, -Y, +Z, -Z) and takes a reference to it
+    unsigned int AcquireCubemap(const vector<string> &faces)
+    {
+        string key = "cubemap";
+        uint64_t contentHash = hashBytes((const unsigned char*)key.data(), key.size());
+        for (const string &face : faces)
+        {
+            key += "|" + NormalizePath(face);
+            uint64_t faceHash = 0;
+            hashFile(face, faceHash);
+            contentHash = hashBytes((const unsigned char*)&faceHash, sizeof(faceHash), contentHash);
+        }
+        auto byPathIt = byPath.find(key);
+        if (byPathIt != byPath.end())
+            return addRef(byPathIt->second);
+        auto byContentIt = byContent.find(contentHash);
+        if (byContentIt != byContent.end())
+        {
+            byPath[key] = byContentIt->second;
+            entries[byContentIt->second].keys.push_back(key);
+            return addRef(byContentIt->second);
+        }
+
+        unsigned int texture;
+        TextureStreamer *streamer = TextureStreamer::Active();
+        if (streamer)
+        {
+            texture = streamer->LoadCubemap(faces);
+        }
+        else
+        {
+            glGenTextures(1, &texture);
+            vector<TextureImage> images;
+            for (const string &face : faces)
+                images.push_back(LoadTextureImage(face));
+            TextureStreamer::UploadNow(texture, GL_TEXTURE_CUBE_MAP, faces, images, false);
+            for (TextureImage &image : images)
+                FreeTextureImage(image);
+        }
+        return insert(texture, key, contentHash);
+    }
+
+    // drops a reference, the texture is deleted when the last one is gone
+    void Release(unsigned int texture)
+    {
+        auto it = entries.find(texture);
+        if (it == entries.end() || --it->second.refs > 0)
+            return;
+        for (const string &key : it->second.keys)
+            byPath.erase(key);
+        byContent.erase(it->second.contentHash);
+        entries.erase(it);
+        cancelStreaming(texture);
+        glDeleteTextures(1, &texture);
+    }
+
+    // deletes every texture regardless of its references. Call before the GL context is destroyed,
+    // later Release calls (e.g. from Model destructors) are then ignored.
+    void Shutdown()
+    {
+        for (auto &entry : entries)
+        {
+            cancelStreaming(entry.first);
+            glDeleteTextures(1, &entry.first);
+        }
+        entries.clear();
+        byPath.clear();
+        byContent.clear();
+    }
+
+    unsigned int TextureCount() const { return entries.size(); }
+
+    // lexically normalized absolute path: resolves ".", ".." and repeated separators
+    static string NormalizePath(const string &path)
+    {
+        char resolved[PATH_MAX];
+        if (realpath(path.c_str(), resolved))
+            return resolved;
+
+        vector<string> parts;
+        size_t start = 0;
+        while (start <= path.size())
+        {
+            size_t end = path.find('/', start);
+            if (end == string::npos)
+                end = path.size();
+            string part = path.substr(start, end - start);
+            if (part == "..")
+            {
+                if (!parts.empty() && parts.back() != "..")
+                    parts.pop_back();
+                else if (path[0] != '/')
+                    parts.push_back(part);
+            }
+            else if (!part.empty() && part != ".")
+            {
+                parts.push_back(part);
+            }
+            start = end + 1;
+        }
+        string normalized = path[0] == '/' ? "/" : "";
+        for (unsigned int i = 0; i < parts.size(); i++)
+            normalized += (i > 0 ? "/" : "") + parts[i];
+        return normalized;
+    }
+
+private:
+    struct Entry {
+        unsigned int refs;
+        uint64_t contentHash;
+        vector<string> keys;
+    };
+
+    unordered_map<string, unsigned int> byPath;
+    unordered_map<uint64_t, unsigned int> byContent;
+    unordered_map<unsigned int, Entry> entries;
+
+    TextureManager() {}
+
+    unsigned int addRef(unsigned int texture)
+    {
+        entries[texture].refs++;
+        return texture;
+    }
+
+    unsigned int insert(unsigned int texture, const string &key, uint64_t contentHash)
+    {
+        Entry entry;
+        entry.refs = 1;
+        entry.contentHash = contentHash;
+        entry.keys.push_back(key);
+        entries[texture] = entry;
+        byPath[key] = texture;
+        byContent[contentHash] = texture;
+        return texture;
+    }
+
+    // a texture deleted while it still streams must not get its pixels later, its name may be reused by then
+    static void cancelStreaming(unsigned int texture)
+    {
+        TextureStreamer *streamer = TextureStreamer::Active();
+        if (streamer)
+            streamer->Cancel(texture);
+    }
+};
+#endif
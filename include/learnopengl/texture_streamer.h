@@ -0,0 +1,487 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/ktx.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/cpu_profiler.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// decoded pixels of an image file. Decoding makes no GL calls, so it can run on a loader thread,
+// the upload then happens on the thread that owns the GL context.
+// Images cooked offline (tools/texture_cooker) carry a compressed mip chain instead of stb pixels.
+struct TextureImage {
+    unsigned char *data = nullptr;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    GLenum compressedFormat = 0;
+    vector<vector<unsigned char>> levels;
+};
+
+inline bool SupportsCompressedFormat(GLenum format)
+{
+    switch (format)
+    {
+        case GL_COMPRESSED_RED_RGTC1:
+        case GL_COMPRESSED_RG_RGTC2:
+            return true;
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            return GLExt().textureCompressionS3TC;
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+            return GLExt().textureCompressionBPTC;
+    }
+    return false;
+}
+
+// loads the cooked KTX next to filename if it is at least as new as the source and the GPU can sample its format
+inline bool LoadCookedTextureImage(const string &filename, TextureImage &image)
+{
+    string cooked = CookedTexturePath(filename);
+    struct stat sourceStat, cookedStat;
+    if (stat(cooked.c_str(), &cookedStat) != 0)
+        return false;
+    if (stat(filename.c_str(), &sourceStat) == 0 && sourceStat.st_mtime > cookedStat.st_mtime)
+        return false;
+    KtxTexture ktx;
+    if (!ReadKtx(cooked, ktx) || !SupportsCompressedFormat(ktx.internalFormat))
+        return false;
+    image.width = ktx.width;
+    image.height = ktx.height;
+    image.components = ktx.baseInternalFormat == GL_RED ? 1 : ktx.baseInternalFormat == GL_RG ? 2 : ktx.baseInternalFormat == GL_RGB ? 3 : 4;
+    image.compressedFormat = ktx.internalFormat;
+    image.levels = std::move(ktx.levels);
+    return true;
+}
+
+inline TextureImage LoadTextureImage(const string &filename)
+{
+    TextureImage image;
+    if (LoadCookedTextureImage(filename, image))
+        return image;
+    image.data = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0);
+    return image;
+}
+
+inline void FreeTextureImage(TextureImage &image)
+{
+    stbi_image_free(image.data);
+    image.data = nullptr;
+    image.levels.clear();
+}
+
+inline GLenum TextureImageFormat(const TextureImage &image)
+{
+    if (image.components == 1)
+        return GL_RED;
+    if (image.components == 2)
+        return GL_RG;
+    if (image.components == 4)
+        return GL_RGBA;
+    return GL_RGB;
+}
+
+inline GLenum TextureImageSizedFormat(const TextureImage &image)
+{
+    if (image.components == 1)
+        return GL_R8;
+    if (image.components == 2)
+        return GL_RG8;
+    if (image.components == 4)
+        return GL_RGBA8;
+    return GL_RGB8;
+}
+
+// Asynchronous texture loading. Load2D/LoadCubemap hand out a texture name right away that shows a 1x1 placeholder.
+// The images are decoded on background threads and Update, called once per frame on the GL thread, streams the
+// decoded pixels into the textures through a ring of pixel buffer objects until the per-frame time budget is used up.
+// A fence per buffer makes sure a buffer is only rewritten once the GPU has consumed its previous upload.
+// The final textures get immutable storage for their full mip chain (see AllocateTextureStorage).
+class TextureStreamer
+{
+public:
+    explicit TextureStreamer(unsigned int decodeThreads = 2, unsigned int pboCount = 3)
+        : pending(0), nextSlot(0), decoder(decodeThreads, "Texture decoder")
+    {
+        slots.resize(pboCount);
+        for (Slot &slot : slots)
+            glGenBuffers(1, &slot.buffer);
+        active() = this;
+    }
+
+    // must be destroyed while the GL context is still current
+    ~TextureStreamer()
+    {
+        if (active() == this)
+            active() = nullptr;
+        for (Slot &slot : slots)
+        {
+            if (slot.fence)
+                glDeleteSync(slot.fence);
+            glDeleteBuffers(1, &slot.buffer);
+        }
+    }
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // the most recently created streamer, Model uses it for its textures when there is one
+    static TextureStreamer *Active() { return active(); }
+
+    // requests a 2D texture with mipmaps. clampTransparent uses GL_CLAMP_TO_EDGE instead of GL_REPEAT for images with
+    // an alpha channel, which prevents semi-transparent borders on blended quads.
+    unsigned int Load2D(const string &path, bool clampTransparent = false)
+    {
+        unsigned int texture = createPlaceholder(GL_TEXTURE_2D);
+        std::shared_ptr<Job> job = std::make_shared<Job>();
+        job->texture = texture;
+        job->target = GL_TEXTURE_2D;
+        job->clampTransparent = clampTransparent;
+        job->paths.push_back(path);
+        submit(job);
+        return texture;
+    }
+
+    // requests a cubemap from six face images in +X, -X, +Y, -Y, +Z, -Z order
+    unsigned int LoadCubemap(const vector<string> &faces)
+    {
+        unsigned int texture = createPlaceholder(GL_TEXTURE_CUBE_MAP);
+        std::shared_ptr<Job> job = std::make_shared<Job>();
+        job->texture = texture;
+        job->target = GL_TEXTURE_CUBE_MAP;
+        job->clampTransparent = false;
+        job->paths = faces;
+        submit(job);
+        return texture;
+    }
+
+    // uploads decoded textures until budgetMs milliseconds have passed. At least one texture is uploaded per call
+    // (if one is ready) so loading always makes progress.
+    void Update(double budgetMs)
+    {
+        PROFILE_ZONE("TextureStreamer::Update");
+        auto start = std::chrono::steady_clock::now();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (;;)
+        {
+            std::shared_ptr<Job> job;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (decoded.empty())
+                    break;
+                job = decoded.front();
+            }
+            Slot &slot = slots[nextSlot];
+            if (slot.fence)
+            {
+                // the GPU is still reading this buffer, try again next frame
+                if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                    break;
+                glDeleteSync(slot.fence);
+                slot.fence = 0;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                decoded.pop_front();
+                auto it = inFlight.find(job->texture);
+                if (it != inFlight.end() && it->second == job)
+                    inFlight.erase(it);
+            }
+            if (upload(*job, slot))
+            {
+                slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                nextSlot = (nextSlot + 1) % slots.size();
+            }
+            freeImages(*job);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+            }
+
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= budgetMs)
+                break;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    // blocks until every requested texture has been uploaded
+    void Flush()
+    {
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (pending == 0)
+                    return;
+                jobDecoded.wait(lock, [this]() { return !decoded.empty(); });
+            }
+            for (Slot &slot : slots)
+            {
+                if (slot.fence)
+                {
+                    glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(-1));
+                    glDeleteSync(slot.fence);
+                    slot.fence = 0;
+                }
+            }
+            Update(1e9);
+        }
+    }
+
+    // drops the request for texture if it is still streaming, call before the texture is deleted. GL reuses deleted
+    // texture names, an upload that went ahead would land in whichever texture gets the name next.
+    void Cancel(unsigned int texture)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = inFlight.find(texture);
+        if (it == inFlight.end())
+            return;
+        it->second->cancelled = true;
+        inFlight.erase(it);
+    }
+
+    // number of requested textures that have not been uploaded yet
+    unsigned int Pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending;
+    }
+
+private:
+    struct Job {
+        unsigned int texture;
+        GLenum target;
+        bool clampTransparent;
+        vector<string> paths;
+        vector<TextureImage> images;
+        // set by Cancel on the GL thread, the decode thread reads it to skip the work
+        std::atomic<bool> cancelled{false};
+    };
+
+    struct Slot {
+        unsigned int buffer = 0;
+        size_t size = 0;
+        GLsync fence = 0;
+    };
+
+    std::mutex mutex;
+    std::condition_variable jobDecoded;
+    std::deque<std::shared_ptr<Job>> decoded;
+    // texture -> its request until the upload, for Cancel
+    std::unordered_map<unsigned int, std::shared_ptr<Job>> inFlight;
+    unsigned int pending;
+    vector<Slot> slots;
+    unsigned int nextSlot;
+    // declared last so the decode threads are joined before the queue they fill is destroyed
+    ThreadPool decoder;
+
+    static TextureStreamer *&active()
+    {
+        static TextureStreamer *streamer = nullptr;
+        return streamer;
+    }
+
+    static unsigned int createPlaceholder(GLenum target)
+    {
+        static const unsigned char grey[4] = {128, 128, 128, 255};
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(target, texture);
+        if (target == GL_TEXTURE_CUBE_MAP)
+        {
+            for (unsigned int face = 0; face < 6; face++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        }
+        else
+        {
+            glTexImage2D(target, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        }
+        // no mipmaps yet, a mipmapped min filter would make the placeholder incomplete
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return texture;
+    }
+
+    void submit(const std::shared_ptr<Job> &job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending++;
+            inFlight[job->texture] = job;
+        }
+        decoder.Submit([this, job]() {
+            PROFILE_ZONE("Decode texture");
+            if (!job->cancelled)
+            {
+                for (const string &path : job->paths)
+                    job->images.push_back(LoadTextureImage(path));
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                decoded.push_back(job);
+            }
+            jobDecoded.notify_all();
+        });
+    }
+
+    // copies the job's pixels into the slot's buffer and specifies the texture from it.
+    // returns false if nothing was uploaded because the job was cancelled or failed to decode.
+    bool upload(Job &job, Slot &slot)
+    {
+        if (job.cancelled || !imagesValid(job.paths, job.images))
+            return false;
+        size_t bytes = 0;
+        for (const TextureImage &image : job.images)
+        {
+            for (unsigned int level = 0; level < levelCount(image); level++)
+                bytes += levelSize(image, level);
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        if (slot.size < bytes)
+        {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+            slot.size = bytes;
+        }
+        unsigned char *dst = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        if (!dst)
+            return false;
+        vector<vector<const void*>> pixels;
+        size_t offset = 0;
+        for (const TextureImage &image : job.images)
+        {
+            pixels.emplace_back();
+            for (unsigned int level = 0; level < levelCount(image); level++)
+            {
+                size_t size = levelSize(image, level);
+                memcpy(dst + offset, levelData(image, level), size);
+                // with a bound unpack buffer the pixel pointer is an offset into it
+                pixels.back().push_back((const void*)offset);
+                offset += size;
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        specify(job.texture, job.target, job.images, pixels, job.clampTransparent);
+        return true;
+    }
+
+public:
+    // synchronous upload of already decoded images into texture, used when no streamer is around
+    static void UploadNow(unsigned int texture, GLenum target, const vector<string> &paths, const vector<TextureImage> &images, bool clampTransparent)
+    {
+        if (!imagesValid(paths, images))
+            return;
+        vector<vector<const void*>> pixels;
+        for (const TextureImage &image : images)
+        {
+            pixels.emplace_back();
+            for (unsigned int level = 0; level < levelCount(image); level++)
+                pixels.back().push_back(levelData(image, level));
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        specify(texture, target, images, pixels, clampTransparent);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+private:
+    static bool imagesValid(const vector<string> &paths, const vector<TextureImage> &images)
+    {
+        for (unsigned int i = 0; i < images.size(); i++)
+        {
+            if ((!images[i].data && images[i].levels.empty()) || images[i].width != images[0].width || images[i].height != images[0].height ||
+                images[i].components != images[0].components || images[i].compressedFormat != images[0].compressedFormat)
+            {
+                std::cout << "Texture failed to load at path: " << paths[i] << std::endl;
+                return false;
+            }
+        }
+        return !images.empty();
+    }
+
+    static unsigned int levelCount(const TextureImage &image)
+    {
+        return image.compressedFormat ? image.levels.size() : 1;
+    }
+
+    static size_t levelSize(const TextureImage &image, unsigned int level)
+    {
+        return image.compressedFormat ? image.levels[level].size() : size_t(image.width) * image.height * image.components;
+    }
+
+    static const void *levelData(const TextureImage &image, unsigned int level)
+    {
+        return image.compressedFormat ? (const void*)image.levels[level].data() : (const void*)image.data;
+    }
+
+    // allocates immutable storage for the texture and fills it from pixels (client memory or unpack buffer offsets,
+    // one list of mip levels per face). Uncompressed images get their mip chain generated, cooked ones bring it along.
+    static void specify(unsigned int texture, GLenum target, const vector<TextureImage> &images, const vector<vector<const void*>> &pixels, bool clampTransparent)
+    {
+        const TextureImage &first = images[0];
+        GLenum format = TextureImageFormat(first);
+        bool compressed = first.compressedFormat != 0;
+        GLsizei levels = compressed ? first.levels.size() : target == GL_TEXTURE_CUBE_MAP ? 1 : MipLevelCount(first.width, first.height);
+        glBindTexture(target, texture);
+        AllocateTextureStorage(target, levels, compressed ? first.compressedFormat : TextureImageSizedFormat(first), first.width, first.height);
+        for (unsigned int face = 0; face < images.size(); face++)
+        {
+            GLenum faceTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+            for (unsigned int level = 0; level < pixels[face].size(); level++)
+            {
+                GLsizei w = std::max(1, first.width >> level), h = std::max(1, first.height >> level);
+                if (compressed)
+                    glCompressedTexSubImage2D(faceTarget, level, 0, 0, w, h, first.compressedFormat, images[face].levels[level].size(), pixels[face][level]);
+                else
+                    glTexSubImage2D(faceTarget, level, 0, 0, w, h, format, GL_UNSIGNED_BYTE, pixels[face][level]);
+            }
+        }
+
+        if (target == GL_TEXTURE_CUBE_MAP)
+        {
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        }
+        else
+        {
+            if (!compressed)
+                glGenerateMipmap(GL_TEXTURE_2D);
+
+            GLint wrap = (clampTransparent && first.components == 4) ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        }
+    }
+
+    static void freeImages(Job &job)
+    {
+        for (TextureImage &image : job.images)
+            FreeTextureImage(image);
+        job.images.clear();
+    }
+};
+#endif
@@ -0,0 +1,83 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <learnopengl/cpu_profiler.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads executing submitted jobs in FIFO order.
+// Jobs must not make GL calls, the GL context is only current on the main thread.
+class ThreadPool
+{
+public:
+    // threadCount == 0 uses one worker per hardware thread. name labels the workers in the CPU profiler.
+    explicit ThreadPool(unsigned int threadCount = 0, const std::string &name = "Worker") : stopping(false)
+    {
+        if (threadCount == 0)
+            threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0)
+            threadCount = 4;
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this, name, i]() {
+                PROFILE_THREAD_NAME(name + " " + std::to_string(i));
+                workerLoop();
+            });
+    }
+
+    // finishes all queued jobs before joining the workers
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wakeUp.notify_one();
+    }
+
+    unsigned int Size() const { return workers.size(); }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+#endif
@@ -0,0 +1,80 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstring>
+
+// Uniform buffer holding one std140 block whose layout is mirrored by the C++ struct T. The buffer is bound to a
+// fixed binding point once, programs attach their block to the same point (Shader::bindUniformBlock), so a single
+// upload serves all of them.
+//
+// data is a plain copy of the block that can be written freely. Upload compares it with what was uploaded last and
+// sends the changed byte range with one glBufferSubData, or nothing at all if no value changed.
+//
+// T has to follow std140 rules: vec3 members are followed by a float or explicit padding, arrays and nested structs
+// are padded to 16 bytes.
+template <typename T>
+class UniformBlock
+{
+public:
+    unsigned int ID;
+    T data;
+
+    explicit UniformBlock(GLuint binding) : binding(binding)
+    {
+        // zeroed bytewise so the padding compares equal in Upload
+        memset(static_cast<void*>(&data), 0, sizeof(T));
+        memset(static_cast<void*>(&uploaded), 0, sizeof(T));
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), &data, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+    }
+
+    UniformBlock(const UniformBlock&) = delete;
+    UniformBlock& operator=(const UniformBlock&) = delete;
+
+    GLuint Binding() const { return binding; }
+
+    // uploads the dirty range of data, returns the number of bytes sent
+    size_t Upload()
+    {
+        const unsigned char *current = reinterpret_cast<const unsigned char*>(&data);
+        unsigned char *previous = reinterpret_cast<unsigned char*>(&uploaded);
+        size_t first = 0, last = sizeof(T);
+        while (first < last && current[first] == previous[first])
+            first++;
+        if (first == last)
+            return 0;
+        while (last > first && current[last - 1] == previous[last - 1])
+            last--;
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, first, last - first, current + first);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        memcpy(previous + first, current + first, last - first);
+        return last - first;
+    }
+
+private:
+    GLuint binding;
+    T uploaded;
+};
+
+// per-frame camera state, shared by every program that declares
+//
+//     layout (std140) uniform Camera {
+//         mat4 projection;
+//         mat4 view;
+//         vec3 viewPosition;
+//     };
+struct CameraBlock {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPosition;
+    float padding;
+};
+#endif
@@ -0,0 +1,228 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+struct Vertex {
+    // position
+    glm::vec3 Position;
+    // normal
+    glm::vec3 Normal;
+    // texCoords
+    glm::vec2 TexCoords;
+    // tangent
+    glm::vec3 Tangent;
+    // bitangent
+    glm::vec3 Bitangent;
+};
+
+// Layouts a Mesh can store its vertices in on the GPU. Vertex (56 bytes of floats) stays the cpu-side and cached
+// format, the mesh converts it when it uploads the vertex buffer.
+enum class VertexLayout {
+    Float,      // position, normal, uv, tangent with the bitangent sign as floats (48 bytes)
+    Packed,     // float position, 10:10:10:2 normal and tangent, half float uv (24 bytes)
+    Quantized   // as Packed, but the position is 16 bit unorm against the mesh bounds (20 bytes)
+};
+
+// Float: every layout hands the shader a 4 component tangent whose w is the bitangent sign, the bitangent itself is
+// rebuilt as cross(normal, tangent.xyz) * tangent.w
+struct FloatVertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+    glm::vec4 Tangent;
+};
+
+// Packed: the tangent's w holds the bitangent sign, the shader rebuilds the bitangent as cross(normal, tangent.xyz) * tangent.w
+struct PackedVertex {
+    glm::vec3 Position;
+    uint32_t Normal;    // GL_INT_2_10_10_10_REV
+    uint32_t Tangent;   // GL_INT_2_10_10_10_REV, w = bitangent sign
+    uint16_t TexCoords[2];
+};
+
+// Quantized: the shader dequantizes with position * positionScale + positionOffset
+struct QuantizedVertex {
+    uint16_t Position[4]; // x, y, z unorm, w unused (keeps the following attributes 4 byte aligned)
+    uint32_t Normal;
+    uint32_t Tangent;
+    uint16_t TexCoords[2];
+};
+
+// one vertex attribute as it is handed to glVertexAttribPointer
+struct VertexAttribute {
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+};
+
+struct VertexFormat {
+    GLsizei stride;
+    vector<VertexAttribute> attributes;
+
+    static const VertexFormat &Of(VertexLayout layout)
+    {
+        static const VertexFormat formats[3] = {
+            {sizeof(FloatVertex), {
+                {0, 3, GL_FLOAT, GL_FALSE, offsetof(FloatVertex, Position)},
+                {1, 3, GL_FLOAT, GL_FALSE, offsetof(FloatVertex, Normal)},
+                {2, 2, GL_FLOAT, GL_FALSE, offsetof(FloatVertex, TexCoords)},
+                {3, 4, GL_FLOAT, GL_FALSE, offsetof(FloatVertex, Tangent)}}},
+            {sizeof(PackedVertex), {
+                {0, 3, GL_FLOAT, GL_FALSE, offsetof(PackedVertex, Position)},
+                {1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertex, Normal)},
+                {2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, TexCoords)},
+                {3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertex, Tangent)}}},
+            {sizeof(QuantizedVertex), {
+                {0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(QuantizedVertex, Position)},
+                {1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(QuantizedVertex, Normal)},
+                {2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(QuantizedVertex, TexCoords)},
+                {3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(QuantizedVertex, Tangent)}}}
+        };
+        return formats[int(layout)];
+    }
+
+    // the position attribute of layout alone, tightly packed, for depth-only passes (see ExtractPositions)
+    static const VertexFormat &PositionsOf(VertexLayout layout)
+    {
+        static const VertexFormat formats[3] = {
+            {sizeof(glm::vec3), {{0, 3, GL_FLOAT, GL_FALSE, 0}}},
+            {sizeof(glm::vec3), {{0, 3, GL_FLOAT, GL_FALSE, 0}}},
+            {4 * sizeof(uint16_t), {{0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 0}}}
+        };
+        return formats[int(layout)];
+    }
+
+    // sets up the attribute pointers of the currently bound VAO for the currently bound GL_ARRAY_BUFFER
+    void Apply() const
+    {
+        for (const VertexAttribute &attribute : attributes)
+        {
+            glEnableVertexAttribArray(attribute.location);
+            glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, stride, (void*)attribute.offset);
+        }
+    }
+};
+
+// half floats have 10 mantissa bits, beyond this range the uv steps get coarser than a texel of a 1k texture
+const float HALF_TEXCOORD_LIMIT = 2.0f;
+
+namespace vertex_pack {
+
+inline uint32_t packNormal(const glm::vec3 &n, float w)
+{
+    return glm::packSnorm3x10_1x2(glm::vec4(glm::clamp(n, -1.0f, 1.0f), w));
+}
+
+inline void packTexCoords(const glm::vec2 &uv, uint16_t out[2])
+{
+    out[0] = glm::packHalf1x16(uv.x);
+    out[1] = glm::packHalf1x16(uv.y);
+}
+
+inline float bitangentSign(const Vertex &v)
+{
+    return glm::dot(glm::cross(v.Normal, v.Tangent), v.Bitangent) < 0.0f ? -1.0f : 1.0f;
+}
+
+}
+
+// the layout a mesh actually gets: packed layouts are only used when the uvs survive the conversion to half floats,
+// meshes with larger (tiled) uvs keep the float layout
+inline VertexLayout ChooseVertexLayout(const Vertex *vertices, unsigned int count, VertexLayout requested)
+{
+    if (requested == VertexLayout::Float)
+        return requested;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (std::fabs(vertices[i].TexCoords.x) > HALF_TEXCOORD_LIMIT || std::fabs(vertices[i].TexCoords.y) > HALF_TEXCOORD_LIMIT)
+            return VertexLayout::Float;
+    }
+    return requested;
+}
+
+// converts vertices to layout. For VertexLayout::Quantized positionScale/positionOffset receive the dequantization
+// parameters, for the other layouts they are the identity.
+inline vector<unsigned char> PackVertices(const Vertex *vertices, unsigned int count, VertexLayout layout,
+                                          glm::vec3 &positionScale, glm::vec3 &positionOffset)
+{
+    positionScale = glm::vec3(1.0f);
+    positionOffset = glm::vec3(0.0f);
+    vector<unsigned char> result(size_t(count) * VertexFormat::Of(layout).stride);
+    if (layout == VertexLayout::Float)
+    {
+        FloatVertex *out = reinterpret_cast<FloatVertex*>(result.data());
+        for (unsigned int i = 0; i < count; i++)
+        {
+            out[i].Position = vertices[i].Position;
+            out[i].Normal = vertices[i].Normal;
+            out[i].TexCoords = vertices[i].TexCoords;
+            out[i].Tangent = glm::vec4(vertices[i].Tangent, vertex_pack::bitangentSign(vertices[i]));
+        }
+    }
+    else if (layout == VertexLayout::Packed)
+    {
+        PackedVertex *out = reinterpret_cast<PackedVertex*>(result.data());
+        for (unsigned int i = 0; i < count; i++)
+        {
+            out[i].Position = vertices[i].Position;
+            out[i].Normal = vertex_pack::packNormal(vertices[i].Normal, 0.0f);
+            out[i].Tangent = vertex_pack::packNormal(vertices[i].Tangent, vertex_pack::bitangentSign(vertices[i]));
+            vertex_pack::packTexCoords(vertices[i].TexCoords, out[i].TexCoords);
+        }
+    }
+    else
+    {
+        glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            lo = glm::min(lo, vertices[i].Position);
+            hi = glm::max(hi, vertices[i].Position);
+        }
+        if (count == 0)
+            lo = hi = glm::vec3(0.0f);
+        positionOffset = lo;
+        positionScale = glm::max(hi - lo, glm::vec3(1e-6f));
+
+        QuantizedVertex *out = reinterpret_cast<QuantizedVertex*>(result.data());
+        for (unsigned int i = 0; i < count; i++)
+        {
+            glm::vec3 normalized = (vertices[i].Position - positionOffset) / positionScale;
+            for (int c = 0; c < 3; c++)
+                out[i].Position[c] = glm::packUnorm1x16(normalized[c]);
+            out[i].Position[3] = 0;
+            out[i].Normal = vertex_pack::packNormal(vertices[i].Normal, 0.0f);
+            out[i].Tangent = vertex_pack::packNormal(vertices[i].Tangent, vertex_pack::bitangentSign(vertices[i]));
+            vertex_pack::packTexCoords(vertices[i].TexCoords, out[i].TexCoords);
+        }
+    }
+    return result;
+}
+
+// copies the positions out of vertices packed by PackVertices into a position-only stream (VertexFormat::PositionsOf).
+// The bytes are the same, so a depth pass reading them rasterizes exactly the depth of the full vertex format.
+inline vector<unsigned char> ExtractPositions(const vector<unsigned char> &packed, VertexLayout layout)
+{
+    const VertexFormat &format = VertexFormat::Of(layout);
+    const size_t positionSize = VertexFormat::PositionsOf(layout).stride;
+    const size_t count = packed.size() / format.stride;
+    vector<unsigned char> result(count * positionSize);
+    // the position is the first member of every vertex struct
+    for (size_t i = 0; i < count; i++)
+        memcpy(&result[i * positionSize], &packed[i * format.stride], positionSize);
+    return result;
+}
+#endif
\ No newline at end of file
@@ -1,17 +1,17 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
+// per-instance model matrix (see InstanceBuffer)
+layout (location = 5) in mat4 aInstanceModel;
 
 out vec2 TexCoords;
 out vec3 FragPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/camera.glsl"
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    FragPos = vec3(aInstanceModel * vec4(aPos, 1.0));
     TexCoords = aTexCoords;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -7,16 +7,43 @@ uniform sampler2D scene;
 uniform sampler2D bloomBlur;
 uniform bool bloom;
 uniform float exposure;
+// parts of scene and bloomBlur that hold this frame's pixels, below 1 when the scene was rendered at a lower
+// resolution (dynamic resolution) and is upscaled here
+uniform vec2 sceneScale;
+uniform vec2 bloomScale;
+// strength of the sharpening that compensates the blur of the bilinear upscale, 0 at native resolution
+uniform float sharpness;
+
+vec3 ToneMap(vec3 hdrColor)
+{
+    return vec3(1.0) - exp(-hdrColor * exposure);
+}
+
+vec3 SceneTap(vec2 uv, vec2 texel)
+{
+    return texture(scene, clamp(uv, texel * 0.5, sceneScale - texel * 0.5)).rgb;
+}
 
 void main()
 {
     const float gamma = 2.2;
-    vec3 hdrColor = texture(scene, TexCoords).rgb;
-    vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
+    vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+    vec2 uv = TexCoords * sceneScale;
+    vec3 bloomColor = vec3(0.0);
     if(bloom)
-        hdrColor += bloomColor; // additive blending
+        bloomColor = texture(bloomBlur, TexCoords * bloomScale).rgb; // additive blending
     // tone mapping
-    vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
+    vec3 result = ToneMap(SceneTap(uv, texel) + bloomColor);
+    if (sharpness > 0.0)
+    {
+        // unsharp mask against the four neighbours one scene texel away, on tone mapped values so bright spots don't
+        // ring. The bloom is smooth enough to reuse the center value.
+        vec3 neighbours = ToneMap(SceneTap(uv + vec2(texel.x, 0.0), texel) + bloomColor);
+        neighbours += ToneMap(SceneTap(uv - vec2(texel.x, 0.0), texel) + bloomColor);
+        neighbours += ToneMap(SceneTap(uv + vec2(0.0, texel.y), texel) + bloomColor);
+        neighbours += ToneMap(SceneTap(uv - vec2(0.0, texel.y), texel) + bloomColor);
+        result = clamp(result + (result - neighbours * 0.25) * sharpness, 0.0, 1.0);
+    }
     // also gamma correct while we're at it
     result = pow(result, vec3(1.0 / gamma));
     FragColor = vec4(result, 1.0);
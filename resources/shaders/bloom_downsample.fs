@@ -0,0 +1,27 @@
+#version 330 core
+// dual filter downsample, renders the next smaller level of the bloom chain. The center tap and the four diagonal
+// taps one source texel away each land between four texels, so five bilinear fetches cover a 4x4 footprint.
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image;
+// part of image that holds this frame's pixels (dynamic resolution), taps are clamped to it
+uniform vec2 imageScale;
+
+vec3 Tap(vec2 uv, vec2 texel)
+{
+    return texture(image, clamp(uv, texel * 0.5, imageScale - texel * 0.5)).rgb;
+}
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(image, 0));
+    vec2 uv = TexCoords * imageScale;
+    vec3 sum = Tap(uv, texel) * 4.0;
+    sum += Tap(uv + vec2(-texel.x, -texel.y), texel);
+    sum += Tap(uv + vec2( texel.x, -texel.y), texel);
+    sum += Tap(uv + vec2(-texel.x,  texel.y), texel);
+    sum += Tap(uv + vec2( texel.x,  texel.y), texel);
+    FragColor = vec4(sum / 8.0, 1.0);
+}
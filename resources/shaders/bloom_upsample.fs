@@ -0,0 +1,30 @@
+#version 330 core
+// dual filter upsample, renders the next larger level of the bloom chain from the blurred smaller one: a ring of
+// four edge taps one source texel away and four diagonal taps half a texel away, the diagonals weighted double
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image;
+// part of image that holds this frame's pixels (dynamic resolution), taps are clamped to it
+uniform vec2 imageScale;
+
+vec3 Tap(vec2 uv, vec2 texel)
+{
+    return texture(image, clamp(uv, texel * 0.5, imageScale - texel * 0.5)).rgb;
+}
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(image, 0));
+    vec2 uv = TexCoords * imageScale;
+    vec3 sum = Tap(uv + vec2(-texel.x, 0.0), texel);
+    sum += Tap(uv + vec2( texel.x, 0.0), texel);
+    sum += Tap(uv + vec2(0.0, -texel.y), texel);
+    sum += Tap(uv + vec2(0.0,  texel.y), texel);
+    sum += Tap(uv + vec2(-texel.x, -texel.y) * 0.5, texel) * 2.0;
+    sum += Tap(uv + vec2( texel.x, -texel.y) * 0.5, texel) * 2.0;
+    sum += Tap(uv + vec2(-texel.x,  texel.y) * 0.5, texel) * 2.0;
+    sum += Tap(uv + vec2( texel.x,  texel.y) * 0.5, texel) * 2.0;
+    FragColor = vec4(sum / 12.0, 1.0);
+}
@@ -0,0 +1,36 @@
+#version 330 core
+// lighting pass of the deferred path: one fullscreen triangle strip that shades every covered pixel of the GBuffer,
+// same lighting as model_lighting.fs
+layout (location = 0) out vec4 FragColor;
+
+in vec2 TexCoords;
+
+#include "include/lights.glsl"
+#include "include/octahedral.glsl"
+#include "include/bloom.glsl"
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+// window coordinates back to world space
+uniform mat4 inverseViewProjection;
+uniform float shininess;
+// part of the GBuffer that holds this frame's pixels (dynamic resolution)
+uniform vec2 gBufferScale;
+
+void main()
+{
+    vec2 uv = TexCoords * gBufferScale;
+    float depth = texture(gDepth, uv).r;
+    // nothing was drawn here, the skybox fills it in the forward pass
+    if (depth == 1.0)
+        discard;
+    vec4 position = inverseViewProjection * vec4(vec3(TexCoords, depth) * 2.0 - 1.0, 1.0);
+    vec3 fragPos = position.xyz / position.w;
+    vec3 normal = DecodeOctahedral(texture(gNormal, uv).xy * 2.0 - 1.0);
+    vec3 viewDir = normalize(viewPosition - fragPos);
+    vec4 albedoSpecular = texture(gAlbedoSpecular, uv);
+    vec3 result = ShadeSceneLights(fragPos, normal, viewDir, albedoSpecular.rgb, vec3(albedoSpecular.a), shininess);
+    FragColor = vec4(result, 1.0);
+    BrightColor = vec4(BrightPass(result), 1.0);
+}
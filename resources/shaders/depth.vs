@@ -0,0 +1,24 @@
+#version 330 core
+// depth pre-pass, reads only the position stream (Mesh::DrawDepth)
+layout (location = 0) in vec3 aPos;
+#ifdef INSTANCED
+layout (location = 5) in mat4 aInstanceModel;
+#else
+uniform mat4 model;
+#endif
+
+#include "include/camera.glsl"
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+// the shading pass tests GL_EQUAL against this depth, both have to compute gl_Position identically
+invariant gl_Position;
+
+void main()
+{
+#ifdef INSTANCED
+    mat4 model = aInstanceModel;
+#endif
+    vec3 position = aPos * positionScale + positionOffset;
+    gl_Position = projection * view * vec4(vec3(model * vec4(position, 1.0)), 1.0);
+}
@@ -0,0 +1,55 @@
+#version 330 core
+// FXAA on the tone mapped image, in the spirit of the console version of FXAA 3.11. The luma contrast of the pixel and
+// its four diagonal neighbours finds edges, the gradient gives the edge direction, then two or four bilinear taps
+// along the edge blur it. The wider blend is dropped when it pulls in colors outside the local luma range, which
+// would mean it crossed into another edge.
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// gamma corrected, in [0, 1]
+uniform sampler2D image;
+
+const float EDGE_THRESHOLD = 1.0 / 8.0;
+const float EDGE_THRESHOLD_MIN = 1.0 / 32.0;
+// limits how far the taps reach along nearly horizontal or vertical edges, in texels
+const float SPAN_MAX = 8.0;
+const float REDUCE_MUL = 1.0 / 8.0;
+const float REDUCE_MIN = 1.0 / 128.0;
+
+float Luma(vec3 color)
+{
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(image, 0));
+    vec3 center = texture(image, TexCoords).rgb;
+    float lumaNW = Luma(texture(image, TexCoords + vec2(-0.5, -0.5) * texel).rgb);
+    float lumaNE = Luma(texture(image, TexCoords + vec2( 0.5, -0.5) * texel).rgb);
+    float lumaSW = Luma(texture(image, TexCoords + vec2(-0.5,  0.5) * texel).rgb);
+    float lumaSE = Luma(texture(image, TexCoords + vec2( 0.5,  0.5) * texel).rgb);
+    float lumaM = Luma(center);
+
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    // flat areas keep their color, most of the screen leaves here after five fetches
+    if (lumaMax - lumaMin < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD))
+    {
+        FragColor = vec4(center, 1.0);
+        return;
+    }
+
+    vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float reduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * REDUCE_MUL, REDUCE_MIN);
+    float scale = 1.0 / (min(abs(direction.x), abs(direction.y)) + reduce);
+    direction = clamp(direction * scale, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * texel;
+
+    vec3 narrow = 0.5 * (texture(image, TexCoords + direction * (1.0 / 3.0 - 0.5)).rgb +
+                         texture(image, TexCoords + direction * (2.0 / 3.0 - 0.5)).rgb);
+    vec3 wide = narrow * 0.5 + 0.25 * (texture(image, TexCoords - direction * 0.5).rgb +
+                                       texture(image, TexCoords + direction * 0.5).rgb);
+    float lumaWide = Luma(wide);
+    FragColor = vec4(lumaWide < lumaMin || lumaWide > lumaMax ? narrow : wide, 1.0);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+// geometry pass of the deferred path, fills the GBuffer targets of the render graph, 12 bytes per pixel:
+//
+//     location 0  RGBA8              albedo.rgb, specular intensity
+//     location 1  RG16               octahedral normal, mapped to [0, 1]
+//     depth       DEPTH_COMPONENT24  scene depth shared with the forward passes, positions are reconstructed from it
+layout (location = 0) out vec4 gAlbedoSpecular;
+layout (location = 1) out vec2 gNormal;
+
+#include "include/material.glsl"
+#include "include/octahedral.glsl"
+
+void main()
+{
+    gAlbedoSpecular = vec4(MaterialDiffuse(), MaterialSpecular().r);
+    gNormal = EncodeOctahedral(MaterialNormal()) * 0.5 + 0.5;
+}
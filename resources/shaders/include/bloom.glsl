@@ -0,0 +1,16 @@
+// bright pass of the bloom, written to the second color attachment of the HDR target next to the shaded color
+layout (location = 1) out vec4 BrightColor;
+
+// brightness where the glow starts, in HDR units before exposure, and the width of the soft transition around it
+const float BLOOM_THRESHOLD = 1.0;
+const float BLOOM_KNEE = 0.5;
+
+// the part of color above the threshold, with a quadratic knee so surfaces don't pop in and out of the glow
+vec3 BrightPass(vec3 color)
+{
+    float brightness = max(color.r, max(color.g, color.b));
+    float soft = clamp(brightness - BLOOM_THRESHOLD + BLOOM_KNEE, 0.0, 2.0 * BLOOM_KNEE);
+    soft = soft * soft / (4.0 * BLOOM_KNEE + 0.00001);
+    float contribution = max(soft, brightness - BLOOM_THRESHOLD) / max(brightness, 0.00001);
+    return color * contribution;
+}
@@ -0,0 +1,6 @@
+// per-frame camera state, filled by UniformBlock<CameraBlock>
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
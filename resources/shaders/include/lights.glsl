@@ -0,0 +1,87 @@
+// light list written by LightManager and the clusters written by LightClusters, shared by every program that shades
+// with the scene lights
+#include "camera.glsl"
+
+// LIGHT_TEXELS texels per light (see light_manager.h for the layout)
+const int LIGHT_TEXELS = 6;
+const float LIGHT_DIRECTIONAL = 0.0;
+const float LIGHT_SPOT = 2.0;
+
+uniform samplerBuffer lights;
+uniform int directionalLightCount;
+
+// point and spot lights per cluster (the counts match LightClusters::CLUSTERS_*)
+const ivec3 CLUSTER_COUNT = ivec3(16, 9, 24);
+
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLights;
+uniform vec2 clusterScale;
+uniform vec2 clusterDepth;
+uniform bool clusterHeatmap;
+
+// Blinn-Phong contribution of light index, directional lights are not attenuated
+vec3 CalcLight(int index, vec3 fragPos, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess)
+{
+    int base = index * LIGHT_TEXELS;
+    vec4 positionType = texelFetch(lights, base);
+    vec4 directionRadius = texelFetch(lights, base + 1);
+    vec3 lightDir;
+    float attenuation = 1.0;
+    if (positionType.w == LIGHT_DIRECTIONAL)
+        lightDir = normalize(-directionRadius.xyz);
+    else
+    {
+        vec3 toLight = positionType.xyz - fragPos;
+        float distance = length(toLight);
+        // outside the radius the light contributes less than one 8 bit step
+        if (distance > directionRadius.w)
+            return vec3(0.0);
+        lightDir = toLight / distance;
+        vec3 attenuationFactors = vec3(texelFetch(lights, base + 2).w, texelFetch(lights, base + 3).w, texelFetch(lights, base + 4).w);
+        attenuation = 1.0 / dot(attenuationFactors, vec3(1.0, distance, distance * distance));
+    }
+    if (positionType.w == LIGHT_SPOT)
+    {
+        // spotlight intensity
+        vec2 cutOff = texelFetch(lights, base + 5).xy;
+        float theta = dot(lightDir, normalize(-directionRadius.xyz));
+        attenuation *= clamp((theta - cutOff.y) / (cutOff.x - cutOff.y), 0.0, 1.0);
+    }
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
+    // combine results
+    vec3 ambient = texelFetch(lights, base + 2).rgb * diffuseColor;
+    vec3 diffuse = texelFetch(lights, base + 3).rgb * diff * diffuseColor;
+    vec3 specular = texelFetch(lights, base + 4).rgb * spec * specularColor;
+    return (ambient + diffuse + specular) * attenuation;
+}
+
+// blue for an empty cluster through green to red at 16 lights and more
+vec3 HeatColor(uint count)
+{
+    float t = clamp(float(count) / 16.0, 0.0, 1.0);
+    return count == 0u ? vec3(0.0, 0.0, 0.3) : mix(mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), clamp(t * 2.0, 0.0, 1.0)),
+                                                   vec3(1.0, 0.0, 0.0), clamp(t * 2.0 - 1.0, 0.0, 1.0));
+}
+
+// directional lights plus the point and spot lights of the fragment's cluster
+vec3 ShadeSceneLights(vec3 fragPos, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess)
+{
+    vec3 result = vec3(0.0);
+    for (int i = 0; i < directionalLightCount; i++)
+        result += CalcLight(i, fragPos, normal, viewDir, diffuseColor, specularColor, shininess);
+
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy * clusterScale), int(log(depth) * clusterDepth.x + clusterDepth.y));
+    cluster = clamp(cluster, ivec3(0), CLUSTER_COUNT - 1);
+    uvec2 range = texelFetch(clusterGrid, (cluster.z * CLUSTER_COUNT.y + cluster.y) * CLUSTER_COUNT.x + cluster.x).xy;
+    for (uint i = 0u; i < range.y; i++)
+        result += CalcLight(int(texelFetch(clusterLights, int(range.x + i)).r), fragPos, normal, viewDir, diffuseColor, specularColor, shininess);
+
+    if (clusterHeatmap)
+        result = mix(result, HeatColor(range.y), 0.6);
+    return result;
+}
@@ -0,0 +1,50 @@
+// surface inputs of the model fragment shaders. The samplers are bound by Mesh, the optional maps only exist in the
+// variants whose mesh has them (see ShaderVariants), the others skip sampling them.
+struct Material {
+    sampler2D texture_diffuse1;
+#ifdef HAS_SPECULAR_MAP
+    sampler2D texture_specular1;
+#endif
+#ifdef HAS_NORMAL_MAP
+    sampler2D texture_normal1;
+#endif
+
+    float shininess;
+};
+
+uniform Material material;
+
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+#ifdef HAS_NORMAL_MAP
+in vec4 Tangent;    // w = bitangent sign
+#endif
+
+vec3 MaterialDiffuse()
+{
+    return texture(material.texture_diffuse1, TexCoords).rgb;
+}
+
+vec3 MaterialSpecular()
+{
+#ifdef HAS_SPECULAR_MAP
+    return texture(material.texture_specular1, TexCoords).rgb;
+#else
+    return vec3(0.0);
+#endif
+}
+
+vec3 MaterialNormal()
+{
+    vec3 normal = normalize(Normal);
+#ifdef HAS_NORMAL_MAP
+    vec3 tangent = normalize(Tangent.xyz - normal * dot(normal, Tangent.xyz));
+    vec3 bitangent = cross(normal, tangent) * Tangent.w;
+    // only x and y are read so two channel (BC5) maps work too, z is reconstructed
+    vec2 xy = texture(material.texture_normal1, TexCoords).rg * 2.0 - 1.0;
+    vec3 mapped = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+    normal = normalize(mat3(tangent, bitangent, normal) * mapped);
+#endif
+    return normal;
+}
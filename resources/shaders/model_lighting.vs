@@ -2,19 +2,42 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+#ifdef HAS_NORMAL_MAP
+// w = bitangent sign, in every vertex layout
+layout (location = 3) in vec4 aTangent;
+#endif
+#ifdef INSTANCED
+// per-instance model matrix (see InstanceBuffer), takes the place of the model uniform
+layout (location = 5) in mat4 aInstanceModel;
+#else
+uniform mat4 model;
+#endif
 
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
+#ifdef HAS_NORMAL_MAP
+out vec4 Tangent;
+#endif
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/camera.glsl"
+// dequantization of 16 bit positions (see VertexLayout::Quantized), identity for the other layouts
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+// matches depth.vs bit for bit, so the shading pass can test GL_EQUAL against the depth pre-pass
+invariant gl_Position;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = aNormal;
-    TexCoords = aTexCoords;    
+#ifdef INSTANCED
+    mat4 model = aInstanceModel;
+#endif
+    vec3 position = aPos * positionScale + positionOffset;
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(model) * aNormal;
+#ifdef HAS_NORMAL_MAP
+    Tangent = vec4(mat3(model) * aTangent.xyz, aTangent.w);
+#endif
+    TexCoords = aTexCoords;
     gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+}
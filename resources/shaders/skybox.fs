@@ -1,10 +1,13 @@
 #version 330 core
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
 
 in vec3 TexCoords;
 
+#include "include/bloom.glsl"
+
 uniform samplerCube skybox;
 
 void main(){
     FragColor = texture(skybox, TexCoords);
+    BrightColor = vec4(BrightPass(FragColor.rgb), 1.0);
 }
\ No newline at end of file
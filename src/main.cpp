@@ -13,8 +13,28 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/model_loader.h>
+#include <learnopengl/texture_manager.h>
+#include <learnopengl/texture_streamer.h>
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/instance_buffer.h>
+#include <learnopengl/uniform_buffer.h>
+#include <learnopengl/light_manager.h>
+#include <learnopengl/light_clusters.h>
+#include <learnopengl/gpu_timer.h>
+#include <learnopengl/gpu_profiler.h>
+#include <learnopengl/cpu_profiler.h>
+#include <learnopengl/bloom.h>
+#include <learnopengl/render_graph.h>
+#include <learnopengl/dynamic_resolution.h>
+#include <learnopengl/antialiasing.h>
+#include <learnopengl/headless_context.h>
+#include <learnopengl/camera_path.h>
+#include <learnopengl/camera_recorder.h>
+#include <learnopengl/benchmark.h>
 #include <math.h>
 
+#include <chrono>
 #include <iostream>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
@@ -47,37 +67,16 @@ float lastFrame = 0.0f;
 
 bool bBloom = true;
 
-struct PointLight {
-    glm::vec3 position;
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
+// fixed uniform buffer binding point of the shared camera block
+const GLuint CAMERA_BLOCK_BINDING = 0;
 
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct DirLight {
-    glm::vec3 direction;
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-};
-
-struct SpotLight{
-    glm::vec3 position;
-    glm::vec3 direction;
-    float cutOff;
-    float outerCutOff;
-
-    float constant;
-    float linear;
-    float quadratic;
-
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
+// one opaque model of the frame, the list is replayed by the depth pre-pass and the shading pass. Models with
+// instances are drawn once per mesh for all of them.
+struct SceneDraw {
+    Model *model;
+    glm::mat4 transform;
+    bool cullFaces;
+    const InstanceBuffer *instances;
 };
 
 struct ProgramState {
@@ -88,6 +87,14 @@ struct ProgramState {
     glm::vec3 backpackPosition = glm::vec3(0.0f);
     float backpackScale = 1.0f;
     PointLight pointLight;
+    bool ClusterHeatmap = false;
+    bool DeferredShading = false;
+    bool DepthPrepass = false;
+    int BloomLevels = 5;
+    bool DynamicResolution = false;
+    float TargetFrameTime = 16.0f;
+    int AntiAliasingMode = AntiAliasing::MSAA;
+    bool ProfilePlayback = true;
     ProgramState()
             : camera(glm::vec3(0.0f, 0.0f, 3.0f)) {}
 
@@ -128,75 +135,136 @@ void ProgramState::LoadFromFile(std::string filename) {
 
 ProgramState *programState;
 
-void DrawImGui(ProgramState *programState);
+// F6 records the camera into CAMERA_RECORDING_FILE, F7 plays the file back. A playback is profiled into
+// PLAYBACK_PROFILE_FILE, the same recording played by two builds gives two CSV files to compare row by row.
+const char *const CAMERA_RECORDING_FILE = "camera_recording.bin";
+const char *const PLAYBACK_PROFILE_FILE = "playback_profile.csv";
+CameraRecorder cameraRecorder;
+// what moved the camera this frame, for the recorder
+CameraInput cameraInput;
+
+void ToggleCameraRecording();
+
+void ToggleCameraPlayback();
+
+void DrawImGui(ProgramState *programState, const RenderGraph &renderGraph, const DynamicResolution &dynamicResolution,
+               const AntiAliasing &antiAliasing, GpuProfiler &profiler);
+
+void DrawCpuProfiler();
 
-int main() {
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+int main(int argc, char **argv) {
+    PROFILE_THREAD_NAME("Main");
+    BenchmarkOptions benchmark;
+    if (!benchmark.Parse(argc, argv))
+        return -1;
+    // --benchmark renders offscreen through EGL along a camera path: no window, no input, no ImGui
+    const bool headless = benchmark.enabled;
+    HeadlessContext headlessContext;
+    CameraPath cameraPath;
+    GLFWwindow *window = NULL;
+    if (headless) {
+        bool pathLoaded;
+        if (benchmark.replay.empty()) {
+            pathLoaded = cameraPath.Load(benchmark.cameraPath);
+        } else {
+            pathLoaded = cameraRecorder.Load(benchmark.replay);
+            cameraPath = cameraRecorder.Path();
+            // the steps of an interactive playback, the last one at the end of the recording
+            benchmark.frames = (unsigned int)std::ceil(cameraPath.Duration() / CameraRecorder::PLAYBACK_STEP) + 1;
+        }
+        if (!pathLoaded || !headlessContext.Create())
+            return -1;
+        if (!gladLoadGLLoader((GLADloadproc) HeadlessContext::GetProcAddress)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            headlessContext.Delete();
+            return -1;
+        }
+        LoadGLExtensions((GLADloadproc) HeadlessContext::GetProcAddress);
+        headlessContext.CreateFramebuffer(benchmark.width, benchmark.height);
+    } else {
+        // glfw: initialize and configure
+        // ------------------------------
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // msaa
-    glfwWindowHint(GLFW_SAMPLES, 4);
+        // the window only receives the tone mapped fullscreen pass, anti-aliasing happens on the scene targets
+        glfwWindowHint(GLFW_SAMPLES, 0);
 
-    // glfw window creation
-    // --------------------
-    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Farming_Life", NULL, NULL);
-    if (window == NULL) {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-    glfwSetKeyCallback(window, key_callback);
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        // glfw window creation
+        // --------------------
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Farming_Life", NULL, NULL);
+        if (window == NULL) {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetKeyCallback(window, key_callback);
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+        // glad: load all OpenGL function pointers
+        // ---------------------------------------
+        if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
+        LoadGLExtensions((GLADloadproc) glfwGetProcAddress);
     }
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     stbi_set_flip_vertically_on_load(true);
 
     programState = new ProgramState;
-    programState->LoadFromFile("resources/program_state.txt");
-    if (programState->ImGuiEnabled) {
-        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+    if (headless) {
+        // the run depends on the command line only, not on the state the last interactive session left
+        programState->DeferredShading = benchmark.deferred;
+        programState->DepthPrepass = benchmark.prepass;
+        programState->AntiAliasingMode = benchmark.antiAliasing;
+    } else {
+        programState->LoadFromFile("resources/program_state.txt");
+        if (programState->ImGuiEnabled) {
+            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        }
+        // Init Imgui
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO &io = ImGui::GetIO();
+        (void) io;
+
+        ImGui_ImplGlfw_InitForOpenGL(window, true);
+        ImGui_ImplOpenGL3_Init("#version 330 core");
     }
-    // Init Imgui
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO &io = ImGui::GetIO();
-    (void) io;
-
-
-
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 330 core");
 
     // configure global opengl state
     // -----------------------------
     // build and compile shaders
     // -------------------------
-    Shader ourShader("resources/shaders/model_lighting.vs", "resources/shaders/model_lighting.fs");
-    Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
-    Shader blendingShader("resources/shaders/blendShader.vs", "resources/shaders/blendShader.fs");
-    Shader hdrShader("resources/shaders/hdr.vs", "resources/shaders/hdr.fs");
-    Shader blurShader("resources/shaders/blur.vs", "resources/shaders/blur.fs");
-    Shader bloomShader("resources/shaders/bloom.vs", "resources/shaders/bloom.fs");
+    // every program is only submitted here, the driver compiles them while the models and textures load
+    ShaderBatch shaderBatch;
+    // the opaque models are drawn through shader variants, every mesh gets the cheapest one its material allows
+    ShaderVariants forwardVariants("resources/shaders/model_lighting.vs", "resources/shaders/model_lighting.fs");
+    Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs", nullptr, "", &shaderBatch);
+    Shader blendingShader("resources/shaders/blendShader.vs", "resources/shaders/blendShader.fs", nullptr, "", &shaderBatch);
+    Shader hdrShader("resources/shaders/hdr.vs", "resources/shaders/hdr.fs", nullptr, "", &shaderBatch);
+    Shader bloomDownsampleShader("resources/shaders/bloom.vs", "resources/shaders/bloom_downsample.fs", nullptr, "", &shaderBatch);
+    Shader bloomUpsampleShader("resources/shaders/bloom.vs", "resources/shaders/bloom_upsample.fs", nullptr, "", &shaderBatch);
+    Shader bloomShader("resources/shaders/bloom.vs", "resources/shaders/bloom.fs", nullptr, "", &shaderBatch);
+    // deferred path: geometry pass into the GBuffer, then one fullscreen lighting pass
+    ShaderVariants gBufferVariants("resources/shaders/model_lighting.vs", "resources/shaders/gbuffer.fs");
+    Shader deferredLightingShader("resources/shaders/hdr.vs", "resources/shaders/deferred_lighting.fs", nullptr, "", &shaderBatch);
+    Shader fxaaShader("resources/shaders/bloom.vs", "resources/shaders/fxaa.fs", nullptr, "", &shaderBatch);
+    // depth pre-pass, reads only the meshes' position streams
+    ShaderVariants depthVariants("resources/shaders/depth.vs", "resources/shaders/depth.fs", SHADER_FEATURE_INSTANCED);
 
     // skybox vertices
     stbi_set_flip_vertically_on_load(false);
@@ -267,59 +335,22 @@ int main() {
             1.0f,  0.5f,  0.0f,  1.0f,  0.0f
     };
 
-    glEnable(GL_MULTISAMPLE);
-
-    unsigned int hdrFBO;
-    glGenFramebuffers(1, &hdrFBO);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-
-    unsigned int colorBuffers[2];
-    glGenTextures(2, colorBuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);  // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // attach texture to framebuffer
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
-    }
-
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    // attach buffers
-
-    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, attachments);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    unsigned int pingpongFBO[2];
-    unsigned int pingpongColorbuffers[2];
-    glGenFramebuffers(2, pingpongFBO);
-    glGenTextures(2, pingpongColorbuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorbuffers[i], 0);
-        // also check if framebuffers are complete (no need for depth buffer)
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "Framebuffer not complete!" << std::endl;
-    }
+    // the render targets are transient resources of the graph, declared every frame below. They are allocated at
+    // the window size, dynamic resolution renders into the lower left part of them.
+    int framebufferWidth, framebufferHeight;
+    auto getFramebufferSize = [&]() {
+        if (headless) {
+            framebufferWidth = benchmark.width;
+            framebufferHeight = benchmark.height;
+        } else {
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        }
+    };
+    getFramebufferSize();
+    RenderGraph renderGraph(framebufferWidth, framebufferHeight);
+    if (headless)
+        renderGraph.SetBackbuffer(headlessContext.Framebuffer());
+    DynamicResolution dynamicResolution;
 
     unsigned int quadVAO, quadVBO;
     glGenVertexArrays(1, &quadVAO);
@@ -355,6 +386,27 @@ int main() {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
     glBindVertexArray(0);
 
+    // textures are decoded in the background and streamed in with a per-frame budget, see TextureStreamer::Update
+    TextureStreamer *textureStreamer = new TextureStreamer;
+
+    // load models
+    // -----------
+    // the imports run on worker threads while the textures below are loaded, Finish then uploads them on this thread
+    Model fieldModel, tractorModel, tractor2Model, cowModel, windmillModel, houseModel,
+          windmillMovModel, windmillStatModel, sunflowerModel, ledModel;
+
+    ModelLoader modelLoader;
+    modelLoader.Load(fieldModel, "resources/objects/field/model.obj");
+    modelLoader.Load(tractorModel, "resources/objects/tractor/Tractor_with_hydraulic_lifter_retopo2_SF.obj");
+    modelLoader.Load(tractor2Model, "resources/objects/tractor2/New_holland_T7_Tractor_SF.obj");
+    modelLoader.Load(cowModel, "resources/objects/cow/cow.obj");
+    modelLoader.Load(windmillModel, "resources/objects/windmill/model.obj");
+    modelLoader.Load(houseModel, "resources/objects/house/model.obj");
+    modelLoader.Load(windmillMovModel, "resources/objects/windmill_mov/windmill.obj");
+    modelLoader.Load(windmillStatModel, "resources/objects/windmill_stat/windmill.obj");
+    modelLoader.Load(sunflowerModel, "resources/objects/sunflower/sunflower.obj");
+    modelLoader.Load(ledModel, "resources/objects/LED/LED_E.obj");
+
     unsigned int grassTexture = loadTexture(FileSystem::getPath("resources/textures/grass/grass-min.png").c_str());
     unsigned int grassTextureSpec = loadTexture(FileSystem::getPath("resources/textures/grass/grass-min_specular.png").c_str());
     // load sky block textures
@@ -369,39 +421,28 @@ int main() {
 
     unsigned int cubemapTexture = loadCubemap(faces);
 
-    // load models
-    // -----------
+    modelLoader.Finish();
 
-    Model fieldModel("resources/objects/field/model.obj");
     fieldModel.SetShaderTextureNamePrefix("material.");
-
-    Model tractorModel("resources/objects/tractor/Tractor_with_hydraulic_lifter_retopo2_SF.obj");
     tractorModel.SetShaderTextureNamePrefix("material.");
-
-    Model tractor2Model("resources/objects/tractor2/New_holland_T7_Tractor_SF.obj");
     tractor2Model.SetShaderTextureNamePrefix("material.");
-
-    Model cowModel("resources/objects/cow/cow.obj");
     cowModel.SetShaderTextureNamePrefix("material.");
-
-    Model windmillModel("resources/objects/windmill/model.obj");
     windmillModel.SetShaderTextureNamePrefix("material.");
-
-    Model houseModel("resources/objects/house/model.obj");
     houseModel.SetShaderTextureNamePrefix("material.");
-
-    Model windmillMovModel("resources/objects/windmill_mov/windmill.obj");
     windmillMovModel.SetShaderTextureNamePrefix("material.");
-
-    Model windmillStatModel("resources/objects/windmill_stat/windmill.obj");
     windmillStatModel.SetShaderTextureNamePrefix("material.");
-
-    Model sunflowerModel("resources/objects/sunflower/sunflower.obj");
     sunflowerModel.SetShaderTextureNamePrefix("material.");
-
-    Model ledModel("resources/objects/LED/LED_E.obj");
     ledModel.SetShaderTextureNamePrefix("material.");
 
+    // the variants depend on the meshes' materials, they are known now and go into the batch as well
+    for (ShaderVariants *variants : {&forwardVariants, &gBufferVariants, &depthVariants}) {
+        for (Model *model : {&fieldModel, &tractorModel, &tractor2Model, &houseModel, &ledModel, &windmillModel,
+                             &windmillMovModel, &windmillStatModel})
+            model->PrepareVariants(*variants, shaderBatch);
+        cowModel.PrepareVariants(*variants, shaderBatch, SHADER_FEATURE_INSTANCED);
+        sunflowerModel.PrepareVariants(*variants, shaderBatch, SHADER_FEATURE_INSTANCED);
+    }
+
     PointLight& pointLight = programState->pointLight;
     pointLight.position = glm::vec3(0.0f, 4.0, 12.0);
     pointLight.ambient = glm::vec3(0.1, 0.1, 0.1);
@@ -412,6 +453,83 @@ int main() {
     pointLight.linear = 0.09f;
     pointLight.quadratic = 0.032f;
 
+    // the camera lives in a uniform buffer shared by all programs, only changed bytes are uploaded per frame
+    UniformBlock<CameraBlock> cameraBlock(CAMERA_BLOCK_BINDING);
+    // from here on the programs are queried and configured
+    shaderBatch.Finish();
+    for (Shader *shader : {&blendingShader, &skyboxShader, &deferredLightingShader})
+        shader->bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+    for (ShaderVariants *variants : {&forwardVariants, &gBufferVariants, &depthVariants}) {
+        variants->onCreate = [](Shader &shader) {
+            shader.bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+            shader.setFloat("material.shininess", 32.0f);
+        };
+    }
+
+    LightManager lightManager;
+    lightManager.Add(DirLight{glm::vec3(-0.2f, -1.0f, 0.3f), glm::vec3(0.01f), glm::vec3(0.2f), glm::vec3(0.3f)});
+    // lamp lights, they follow the point light edited in the ImGui window
+    size_t lampLight1 = lightManager.Add(PointLight{glm::vec3(10.1f, -1.87f, 17.3f), pointLight.ambient, pointLight.diffuse,
+                                                    pointLight.specular, 0.45f, 0.85f, 0.032f});
+    size_t lampLight2 = lightManager.Add(PointLight{glm::vec3(9.6f, -1.87f, 17.3f), pointLight.ambient, pointLight.diffuse,
+                                                    pointLight.specular, 0.45f, 0.85f, 0.032f});
+    lightManager.Add(PointLight{glm::vec3(10.5f, -1.0f, 12.6f), glm::vec3(0.1f), glm::vec3(0.73f, 0.1176f, 0.0627f),
+                                glm::vec3(0.73f, 0.1176f, 0.0627f), 0.3f, 0.85f, 0.032f});
+    lightManager.Add(PointLight{glm::vec3(8.8f, -1.0f, 12.6f), glm::vec3(0.1f), glm::vec3(0.73f, 0.1176f, 0.0627f),
+                                glm::vec3(0.73f, 0.1176f, 0.0627f), 0.3f, 0.85f, 0.032f});
+    // the rotating lights sweep every frame through their outer cutoff
+    size_t rotLight = lightManager.Add(SpotLight{glm::vec3(9.1f, -0.22f, 14.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                                                 glm::cos(glm::radians(0.0f)), glm::cos(glm::radians(0.0f)), 0.1f, 0.9f, 0.032f,
+                                                 glm::vec3(0.1f), glm::vec3(1.0f, 0.6f, 0.0f), glm::vec3(1.0f, 0.6f, 0.0f)});
+    size_t rotLight1 = lightManager.Add(SpotLight{glm::vec3(9.1f, -0.22f, 14.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                                                  glm::cos(glm::radians(0.0f)), glm::cos(glm::radians(180.0f)), 0.1f, 0.9f, 0.032f,
+                                                  glm::vec3(0.1f), glm::vec3(1.0f, 0.6f, 0.0f), glm::vec3(1.0f, 0.6f, 0.0f)});
+    lightManager.Add(SpotLight{glm::vec3(9.9f, -2.3f, 14.5f), glm::vec3(0.0f, -0.07f, 1.0f),
+                               glm::cos(glm::radians(19.875f)), glm::cos(glm::radians(21.0f)), 1.0f, 0.09f, 0.032f,
+                               glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(1.0f)});
+    lightManager.Add(SpotLight{glm::vec3(9.5f, -2.3f, 14.5f), glm::vec3(0.0f, -0.07f, 1.0f),
+                               glm::cos(glm::radians(19.875f)), glm::cos(glm::radians(21.0f)), 1.0f, 0.09f, 0.032f,
+                               glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(1.0f)});
+    // point and spot lights are binned into view frustum clusters, fragments shade only their cluster's lights
+    LightClusters lightClusters;
+
+    // the forward variants read the light list and the clusters, bound once per frame per variant
+    forwardVariants.onFrame = [&](Shader &shader) {
+        lightManager.Bind(shader);
+        lightClusters.Bind(shader, programState->ClusterHeatmap);
+    };
+
+    // GPU time and pipeline statistics per pass, shown in the ImGui profiler window. The frame timer spans all of
+    // them and ImGui.
+    GpuProfiler profiler;
+    GpuTimer &frameTimer = profiler.Timer("Frame");
+    GpuTimer &prepassTimer = profiler.Timer("Depth pre-pass", true);
+    GpuTimer &opaqueTimer = profiler.Timer("Opaque shading", true);
+    GpuTimer &lightingTimer = profiler.Timer("Deferred lighting", true);
+    GpuTimer &grassTimer = profiler.Timer("Grass", true);
+    GpuTimer &skyboxTimer = profiler.Timer("Skybox", true);
+    GpuTimer &resolveTimer = profiler.Timer("MSAA resolve", true);
+    GpuTimer &bloomTimer = profiler.Timer("Bloom", true);
+    GpuTimer &postTimer = profiler.Timer("Tone mapping", true);
+    GpuTimer &fxaaTimer = profiler.Timer("FXAA", true);
+    std::vector<SceneDraw> sceneDraws;
+    // the bright pass is blurred down a chain of half, quarter, eighth, ... resolution targets and back up
+    Bloom bloom(bloomDownsampleShader, bloomUpsampleShader, quadVAO);
+    AntiAliasing antiAliasing(fxaaShader, quadVAO);
+
+    deferredLightingShader.use();
+    deferredLightingShader.setFloat("shininess", 32.0f);
+    deferredLightingShader.setInt("gAlbedoSpecular", 0);
+    deferredLightingShader.setInt("gNormal", 1);
+    deferredLightingShader.setInt("gDepth", 2);
+    blendingShader.use();
+    blendingShader.setInt("texture1", 0);
+    skyboxShader.use();
+    skyboxShader.setInt("skybox", 0);
+    bloomShader.use();
+    bloomShader.setInt("scene", 0);
+    bloomShader.setInt("bloomBlur", 1);
+
     // draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     glEnable(GL_DEPTH_TEST);
@@ -431,345 +549,467 @@ int main() {
             glm::vec3(-38.0f, -3.1f, 23.0f)
     };
 
+    // every grass position gets six quads rotated around the vertical axis, all drawn with a single instanced draw
+    std::vector<glm::mat4> grassMatrices;
+    for (auto i : grassPositions)
+    {
+        float grassAngle = 0.0f;
+        for(int j = 0; j < 6; j++) {
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(model, i);
+            model = glm::rotate(model, glm::radians(grassAngle), glm::vec3(0.0f, 1.0f, 0.0f));
+            model = glm::translate(model, glm::vec3(-0.5f, 0.0f, 0.0f));
+            grassMatrices.push_back(model);
+            grassAngle += 30.0f;
+        }
+    }
+    InstanceBuffer grassInstances(grassMatrices);
+    glBindVertexArray(grassVAO);
+    grassInstances.Attach();
+    glBindVertexArray(0);
+
+    std::vector<glm::vec3> cowPositions = {
+            glm::vec3(-12.0f, -3.56f, 8.1f),
+            glm::vec3(-22.0f, -3.58f, 12.0f)
+    };
+    std::vector<glm::mat4> cowMatrices;
+    for(unsigned int i = 0; i < cowPositions.size(); i++){
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, cowPositions[i]);
+        model = glm::rotate(model, glm::radians(95.0f * float(i)), glm::vec3(0.0f, 1.0f, 0.0f));
+        model = glm::scale(model, glm::vec3(0.2f));
+        cowMatrices.push_back(model);
+    }
+    InstanceBuffer cowInstances(cowMatrices);
+
+    // 8 rows of 45 sunflowers
+    glm::vec3 positionOfSunflower = glm::vec3(-29.0f, -4.2f, -9.0f);
+    std::vector<glm::mat4> sunflowerMatrices;
+    float zOfSunflowerRow = 0.0f;
+    for(int i = 0; i < 8; i++){
+        for(int j = 0; j < 45; j++){
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(model, positionOfSunflower + glm::vec3(float(j) * 1.5f, 0.0f, zOfSunflowerRow));
+            model = glm::scale(model, glm::vec3(0.02f));
+            sunflowerMatrices.push_back(model);
+        }
+        zOfSunflowerRow -= 2.5f;
+    }
+    InstanceBuffer sunflowerInstances(sunflowerMatrices);
+
     float rotAngle = 0.0f;
 
-    while (!glfwWindowShouldClose(window)) {
-
-        currTime = glfwGetTime();
-        timeDiff = currTime - prevTime;
-        counter++;
-        if(timeDiff >= 1.0 / 30.0){
-            std::string FPS = std::to_string(1.0 / timeDiff * counter);
-            std::string ms = std::to_string((timeDiff / counter) * 1000);
-            std::string newTitle = FPS + " - FPS / " + ms + " - ms";
-            glfwSetWindowTitle(window, newTitle.c_str());
-            prevTime = currTime;
-            counter = 0;
+    // the benchmark steps the scene with a fixed timestep, so every run renders the same frames: the warm-up frames
+    // hold the start of the camera path, the measured frames fly it once
+    BenchmarkRecorder benchmarkRecorder;
+    unsigned int benchmarkFrame = 0;
+    const float benchmarkStep = benchmark.replay.empty() ? cameraPath.Duration() / benchmark.frames
+                                                         : CameraRecorder::PLAYBACK_STEP;
+    unsigned long frameTimerResults = 0;
+    // the playback profile goes on for GpuTimer::LATENCY frames after the playback, until the last GPU results are in
+    bool profilingPlayback = false;
+    unsigned int playbackProfileTail = 0;
+    auto millisecondsSince = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    // textures still streaming in would make the first measured frames slow
+    if (headless)
+        textureStreamer->Flush();
+
+    while (headless ? benchmarkFrame < benchmark.warmupFrames + benchmark.frames : !glfwWindowShouldClose(window)) {
+        PROFILE_FRAME();
+        PROFILE_ZONE("Frame");
+        std::chrono::steady_clock::time_point frameBegin = std::chrono::steady_clock::now();
+
+        if (!headless) {
+            currTime = glfwGetTime();
+            timeDiff = currTime - prevTime;
+            counter++;
+            if(timeDiff >= 1.0 / 30.0){
+                std::string FPS = std::to_string(1.0 / timeDiff * counter);
+                std::string ms = std::to_string((timeDiff / counter) * 1000);
+                std::string newTitle = FPS + " - FPS / " + ms + " - ms";
+                glfwSetWindowTitle(window, newTitle.c_str());
+                prevTime = currTime;
+                counter = 0;
+            }
         }
 
         // per-frame time logic
         // --------------------
-        float currentFrame = glfwGetTime();
+        float currentFrame = headless ? benchmarkStep * benchmarkFrame : (float)glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        // the scene animation, it starts over with every camera playback so all of them render the same frames
+        float sceneTime = currentFrame;
+
         // -----
-        processInput(window);
+        if (headless) {
+            float pathTime = benchmarkStep * ((float)benchmarkFrame - (float)benchmark.warmupFrames);
+            cameraPath.Apply(programState->camera, pathTime);
+            if (benchmarkFrame == benchmark.warmupFrames)
+                rotAngle = 0.0f;
+            sceneTime = std::max(pathTime, 0.0f);
+        } else {
+            processInput(window);
+            if (cameraRecorder.GetState() == CameraRecorder::PLAYING && cameraRecorder.PlaybackFrame() == 0) {
+                rotAngle = 0.0f;
+                if (programState->ProfilePlayback && profiler.StartCsv(PLAYBACK_PROFILE_FILE)) {
+                    profilingPlayback = true;
+                    playbackProfileTail = 0;
+                }
+            }
+            // playback overrides whatever the input did to the camera
+            float playbackTime;
+            if (cameraRecorder.Playback(programState->camera, playbackTime))
+                sceneTime = playbackTime;
+            cameraRecorder.Capture(currentFrame, programState->camera, cameraInput);
+            cameraInput.Clear();
+        }
+
+        // upload textures that finished decoding, bounded so loading never causes a long frame
+        textureStreamer->Update(2.0);
 
 
         // render
         // ------
         //glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
-        glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        blendingShader.use();
-        blendingShader.setInt("texture1", 0);
-        PointLight rotPointLight;
-
-        ourShader.setVec3("pointLight.position", 9.1f, 0.0f, 14.0f);
-        ourShader.setVec3("pointLight.ambient", 0.1f, 0.1f, 0.1f);
-        ourShader.setVec3("pointLight.diffuse", 1.0f, 0.6f, 0.0f);
-        ourShader.setVec3("pointLight.specular", 1.0f, 0.6f, 0.0f);
-        ourShader.setFloat("pointLight.constant", 0.2f);
-        ourShader.setFloat("pointLight.linear", 0.9f);
-        ourShader.setFloat("pointLight.quadratic", 0.032f);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-
-        blendingShader.setVec3("dirLight.direction", -0.2f, -1.0f, 0.3f);
-        blendingShader.setVec3("dirLight.ambient", 0.01f, 0.01f, 0.01f);
-        blendingShader.setVec3("dirLight.diffuse", 0.2f, 0.2f, 0.2f);
-        blendingShader.setVec3("dirLight.specular", 0.3f, 0.3f, 0.3f);
-        
+        // the opaque models go straight into the HDR target (forward) or into the GBuffer (deferred), grass and skybox
+        // are always drawn forward afterwards
+        bool deferred = programState->DeferredShading;
+        ShaderVariants &sceneVariants = deferred ? gBufferVariants : forwardVariants;
+        for (ShaderVariants *variants : {&forwardVariants, &gBufferVariants, &depthVariants})
+            variants->NextFrame();
+
+        // follow the window size, a minimized window has none and renders nothing
+        getFramebufferSize();
+        if (framebufferWidth == 0 || framebufferHeight == 0) {
+            glfwPollEvents();
+            continue;
+        }
+        renderGraph.Resize(framebufferWidth, framebufferHeight);
+        // GPU time of the passes measured so far
+        double gpuMilliseconds = 0.0;
+        for (const GpuTimer *timer : renderGraph.Timers())
+            gpuMilliseconds += timer->Milliseconds();
+        int antiAliasingMode = AntiAliasing::Effective(programState->AntiAliasingMode, deferred);
+        antiAliasing.Record(antiAliasingMode, gpuMilliseconds);
+        // the scale for this frame
+        if (programState->DynamicResolution) {
+            dynamicResolution.targetMilliseconds = programState->TargetFrameTime;
+            dynamicResolution.Update(gpuMilliseconds);
+        } else {
+            dynamicResolution.Reset();
+        }
+        renderGraph.SetRenderScale(dynamicResolution.Scale());
+        float aspect = (float)framebufferWidth / (float)framebufferHeight;
+
         glm::mat4 model = glm::mat4(1.0f);
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = programState->camera.GetViewMatrix();
-        blendingShader.setMat4("projection", projection);
-        blendingShader.setMat4("view", view);
-        glBindVertexArray(grassVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, grassTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, grassTextureSpec);
-
-
-        for (auto i : grassPositions)
-        {
-            float grassAngle = 0.0f;
-            for(int j = 0; j < 6; j++) {
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, i);
-                model = glm::rotate(model, glm::radians(grassAngle), glm::vec3(0.0f, 1.0f, 0.0f));
-                model = glm::translate(model, glm::vec3(-0.5f, 0.0f, 0.0f));
-                blendingShader.setMat4("model", model);
-                glDrawArrays(GL_TRIANGLES, 0, 6);
-                grassAngle += 30.0f;
-            }
+        const float zNear = 0.1f, zFar = 100.0f;
+        cameraBlock.data.projection = glm::perspective(glm::radians(programState->camera.Zoom), aspect, zNear, zFar);
+        cameraBlock.data.view = programState->camera.GetViewMatrix();
+        cameraBlock.data.viewPosition = programState->camera.Position;
+        cameraBlock.Upload();
+
+        lightManager.spotLights[rotLight].outerCutOff = glm::cos(glm::radians(rotAngle));
+        lightManager.spotLights[rotLight1].outerCutOff = glm::cos(glm::radians(180.0f + rotAngle));
+        for (size_t lamp : {lampLight1, lampLight2}) {
+            PointLight &light = lightManager.pointLights[lamp];
+            light.ambient = pointLight.ambient;
+            light.diffuse = pointLight.diffuse;
+            light.specular = pointLight.specular;
         }
-        glBindVertexArray(0);
-        glEnable(GL_CULL_FACE);
-
-        ourShader.use();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-
-        PointLight pointLight1, pointLight2;
-
-        ourShader.setFloat("material.shininess", 32.0f);
-        ourShader.setVec3("rotPointLight.position", 9.1f, -0.22f, 14.0f);
-        ourShader.setVec3("rotPointLight.direction", glm::vec3(0.0f, 0.0f, 1.0f));
-        ourShader.setVec3("rotPointLight.ambient", 0.1f, 0.1f, 0.1f);
-        ourShader.setVec3("rotPointLight.diffuse", 1.0f, 0.6f, 0.0f);
-        ourShader.setVec3("rotPointLight.specular", 1.0f, 0.6f, 0.0f);
-        ourShader.setFloat("rotPointLight.constant", 0.1f);
-        ourShader.setFloat("rotPointLight.linear", 0.9f);
-        ourShader.setFloat("rotPointLight.quadratic", 0.032f);
-        ourShader.setFloat("rotPointLight.cutOff", glm::cos(glm::radians(0.0f)));
-        ourShader.setFloat("rotPointLight.outerCutOff", glm::cos(glm::radians(rotAngle)));
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-
-        ourShader.setVec3("rotPointLight1.position", 9.1f, -0.22f, 14.0f);
-        ourShader.setVec3("rotPointLight1.direction", glm::vec3(0.0f, 0.0f, -1.0f));
-        ourShader.setVec3("rotPointLight1.ambient", 0.1f, 0.1f, 0.1f);
-        ourShader.setVec3("rotPointLight1.diffuse", 1.0f, 0.6f, 0.0f);
-        ourShader.setVec3("rotPointLight1.specular", 1.0f, 0.6f, 0.0f);
-        ourShader.setFloat("rotPointLight1.constant", 0.1f);
-        ourShader.setFloat("rotPointLight1.linear", 0.9f);
-        ourShader.setFloat("rotPointLight1.quadratic", 0.032f);
-        ourShader.setFloat("rotPointLight1.cutOff", glm::cos(glm::radians(0.0f)));
-        ourShader.setFloat("rotPointLight1.outerCutOff", glm::cos(glm::radians(180.0f + rotAngle)));
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-
-        ourShader.setVec3("pointLight1.position", 10.1f, -1.87f, 17.3f);
-        ourShader.setVec3("pointLight1.ambient", pointLight.ambient);
-        ourShader.setVec3("pointLight1.diffuse", pointLight.diffuse);
-        ourShader.setVec3("pointLight1.specular", pointLight.specular);
-        ourShader.setFloat("pointLight1.constant", 0.45f);
-        ourShader.setFloat("pointLight1.linear", 0.85f);
-        ourShader.setFloat("pointLight1.quadratic", 0.032f);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-
-        ourShader.setVec3("pointLight2.position", 9.6f, -1.87f, 17.3f);
-        ourShader.setVec3("pointLight2.ambient", pointLight.ambient);
-        ourShader.setVec3("pointLight2.diffuse", pointLight.diffuse);
-        ourShader.setVec3("pointLight2.specular", pointLight.specular);
-        ourShader.setFloat("pointLight2.constant", 0.45f);
-        ourShader.setFloat("pointLight2.linear", 0.85f);
-        ourShader.setFloat("pointLight2.quadratic", 0.032f);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-
-        ourShader.setVec3("dirLight.direction", -0.2f, -1.0f, 0.3f);
-        ourShader.setVec3("dirLight.ambient", 0.01f, 0.01f, 0.01f);
-        ourShader.setVec3("dirLight.diffuse", 0.2f, 0.2f, 0.2f);
-        ourShader.setVec3("dirLight.specular", 0.3f, 0.3f, 0.3f);
-
-
-        SpotLight spotLight1;
-        SpotLight spotLight2;
-
-
-        ourShader.setVec3("spotLight1.position", 9.9f, -2.3f, 14.5f);
-        ourShader.setVec3("spotLight1.direction", 0.0f, -0.07f, 1.0f);
-        ourShader.setVec3("spotLight1.ambient", 0.0f, 0.0f, 0.0f);
-        ourShader.setVec3("spotLight1.diffuse", 1.0f, 1.0f, 1.0f);
-        ourShader.setVec3("spotLight1.specular", 1.0f, 1.0f, 1.0f);
-        ourShader.setFloat("spotLight1.constant", 1.0f);
-        ourShader.setFloat("spotLight1.linear", 0.09);
-        ourShader.setFloat("spotLight1.quadratic", 0.032);
-        ourShader.setFloat("spotLight1.cutOff", glm::cos(glm::radians(19.875f)));
-        ourShader.setFloat("spotLight1.outerCutOff", glm::cos(glm::radians(21.0f)));
-
-        ourShader.setVec3("spotLight2.position", 9.5f, -2.3f, 14.5f);
-        ourShader.setVec3("spotLight2.direction", 0.0f, -0.07f, 1.0f);
-        ourShader.setVec3("spotLight2.ambient", 0.0f, 0.0f, 0.0f);
-        ourShader.setVec3("spotLight2.diffuse", 1.0f, 1.0f, 1.0f);
-        ourShader.setVec3("spotLight2.specular", 1.0f, 1.0f, 1.0f);
-        ourShader.setFloat("spotLight2.constant", 1.0f);
-        ourShader.setFloat("spotLight2.linear", 0.09);
-        ourShader.setFloat("spotLight2.quadratic", 0.032);
-        ourShader.setFloat("spotLight2.cutOff", glm::cos(glm::radians(19.875f)));
-        ourShader.setFloat("spotLight2.outerCutOff", glm::cos(glm::radians(21.0f)));
-
-
-        ourShader.setVec3("pointLight3.position", 10.5f, -1.0f, 12.6f);
-        ourShader.setVec3("pointLight3.ambient", glm::vec3(0.1f));
-        ourShader.setVec3("pointLight3.diffuse", glm::vec3(0.73f, 0.1176f, 0.0627f));
-        ourShader.setVec3("pointLight3.specular", glm::vec3(0.73f, 0.1176f, 0.0627f));
-        ourShader.setFloat("pointLight3.constant", 0.3f);
-        ourShader.setFloat("pointLight3.linear", 0.85f);
-        ourShader.setFloat("pointLight3.quadratic", 0.032f);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-
-        ourShader.setVec3("pointLight4.position", 8.8f, -1.0f, 12.6f);
-        ourShader.setVec3("pointLight4.ambient", glm::vec3(0.1f));
-        ourShader.setVec3("pointLight4.diffuse", glm::vec3(0.73f, 0.1176f, 0.0627f));
-        ourShader.setVec3("pointLight4.specular", glm::vec3(0.73f, 0.1176f, 0.0627f));
-        ourShader.setFloat("pointLight4.constant", 0.3f);
-        ourShader.setFloat("pointLight4.linear", 0.85f);
-        ourShader.setFloat("pointLight4.quadratic", 0.032f);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
+        lightManager.Upload();
+        // the clusters tile the part of the targets that is rendered
+        glm::ivec2 renderSize = renderGraph.RenderSize();
+        lightClusters.Update(cameraBlock.data.view, glm::radians(programState->camera.Zoom), aspect,
+                             zNear, zFar, renderSize.x, renderSize.y, lightManager);
+
+        // opaque models of this frame
+        sceneDraws.clear();
+        bool cullFaces = true;
 
         // render the loaded model
         model = glm::mat4(1.0f);
         model = glm::translate(model,glm::vec3(0.0f,0.0f,0.0f)); // translate it down so it's at the center of the scene
         model = glm::rotate(model, glm::radians(4.675f), glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::scale(model, glm::vec3(1.0f));    // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        fieldModel.Draw(ourShader);
+        sceneDraws.push_back({&fieldModel, model, cullFaces, nullptr});
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, -3.6f,12.0f));
         model = glm::scale(model, glm::vec3(0.4f));
-        ourShader.setMat4("model", model);
-        tractorModel.Draw(ourShader);
+        sceneDraws.push_back({&tractorModel, model, cullFaces, nullptr});
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(9.0f, -3.6f, 12.0f));
         model = glm::scale(model, glm::vec3(1.0f));
-        ourShader.setMat4("model", model);
-        tractor2Model.Draw(ourShader);
+        sceneDraws.push_back({&tractor2Model, model, cullFaces, nullptr});
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(-29.0f, -6.3f, 26.0f));
         model = glm::rotate(model, glm::radians(-0.4f), glm::vec3(1.0f, 0.0f, 0.0f));
         model = glm::scale(model, glm::vec3(0.5f));
-        ourShader.setMat4("model", model);
-        houseModel.Draw(ourShader);
+        sceneDraws.push_back({&houseModel, model, cullFaces, nullptr});
 
-        glDisable(GL_CULL_FACE);
+        cullFaces = false;
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(9.1f, -0.42f, 14.0f));
         model = glm::rotate(model, glm::radians(float(rotAngle)), glm::vec3(0.0f, 1.0f, 0.0f));
         rotAngle += 15.0f;
         model = glm::scale(model, glm::vec3(0.1f));
-        ourShader.setMat4("model", model);
-        ledModel.Draw(ourShader);
-
-        glEnable(GL_CULL_FACE);
+        sceneDraws.push_back({&ledModel, model, cullFaces, nullptr});
 
-        std::vector<glm::vec3> cowPositions = {
-                glm::vec3(-12.0f, -3.56f, 8.1f),
-                glm::vec3(-22.0f, -3.58f, 12.0f)
-        };
-
-        for(int i = 0; i < cowPositions.size(); i++){
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, cowPositions[i]);
-            model = glm::rotate(model, glm::radians(95.0f * float(i)), glm::vec3(0.0f, 1.0f, 0.0f));
-            model = glm::scale(model, glm::vec3(0.2f));
-            ourShader.setMat4("model", model);
-            cowModel.Draw(ourShader);
-        }
+        cullFaces = true;
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(21.0f, -3.8f, 10.0f));
         model = glm::rotate(model, glm::radians(170.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::scale(model, glm::vec3(0.5f));
-        ourShader.setMat4("model", model);
-        windmillModel.Draw(ourShader);
+        sceneDraws.push_back({&windmillModel, model, cullFaces, nullptr});
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(-27.225f, 2.425f, 3.725f));
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::rotate(model, glm::radians(-7.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians((float)glfwGetTime()*10), glm::vec3(0.0f, 0.0f, 1.0f));
+        model = glm::rotate(model, glm::radians(sceneTime * 10), glm::vec3(0.0f, 0.0f, 1.0f));
         model = glm::scale(model, glm::vec3(1.0f));
-        ourShader.setMat4("model", model);
-        windmillMovModel.Draw(ourShader);
+        sceneDraws.push_back({&windmillMovModel, model, cullFaces, nullptr});
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(-30.0f, -4.6f, 4.0f));
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::scale(model, glm::vec3(1.0f));
-        ourShader.setMat4("model", model);
-        windmillStatModel.Draw(ourShader);
-
-        glm::vec3 positionOfSunflower = glm::vec3(-29.0f, -4.2f, -9.0f);
-        float zOfSunflowerRow = 0.0f;
-        for(int i = 0; i < 8; i++){
-            for(int j = 0; j < 45; j++){
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, positionOfSunflower + glm::vec3(float(j) * 1.5f, 0.0f, zOfSunflowerRow));
-                model = glm::scale(model, glm::vec3(0.02f));
-                ourShader.setMat4("model", model);
-                sunflowerModel.Draw(ourShader);
+        sceneDraws.push_back({&windmillStatModel, model, cullFaces, nullptr});
+
+        // repeated props: one draw per mesh for all instances
+        sceneDraws.push_back({&cowModel, glm::mat4(1.0f), true, &cowInstances});
+        sceneDraws.push_back({&sunflowerModel, glm::mat4(1.0f), true, &sunflowerInstances});
+
+        // replays the opaque draws, depth only for the pre-pass
+        auto drawOpaque = [&](ShaderVariants &variants, bool depthOnly) {
+            for (const SceneDraw &draw : sceneDraws) {
+                if (draw.cullFaces)
+                    glEnable(GL_CULL_FACE);
+                else
+                    glDisable(GL_CULL_FACE);
+                if (draw.instances && depthOnly)
+                    draw.model->DrawDepthInstanced(variants, *draw.instances, draw.instances->Count());
+                else if (draw.instances)
+                    draw.model->DrawInstanced(variants, *draw.instances, draw.instances->Count());
+                else if (depthOnly)
+                    draw.model->DrawDepth(variants, draw.transform);
+                else
+                    draw.model->Draw(variants, draw.transform);
             }
-            zOfSunflowerRow -= 2.5f;
-        }
-
-        glDepthFunc(GL_LEQUAL);
-        skyboxShader.use();
-        skyboxShader.setInt("skybox", 0);
-
-        skyboxShader.setMat4("view", glm::mat4(glm::mat3(view)));
-        skyboxShader.setMat4("projection", projection);
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        };
 
-        glDepthFunc(GL_LESS);
+        // the frame as a render graph: targets are pooled and cleared by the graph, passes whose outputs nobody reads
+        // are culled (e.g. the bloom chain while bloom is off)
+        renderGraph.Reset();
+        unsigned int samples = antiAliasing.Samples(antiAliasingMode);
+        RenderGraph::Resource sceneDepth = renderGraph.Create("Scene depth", GL_DEPTH_COMPONENT24, 1.0f, samples);
+        RenderGraph::Resource hdrColor = renderGraph.Create("HDR color", GL_RGBA16F);
+        RenderGraph::Resource brightColor = renderGraph.Create("Bright pass", GL_R11F_G11F_B10F);
+        // with MSAA the scene is drawn into multisampled copies that are resolved before bloom and tone mapping
+        RenderGraph::Resource sceneColor = hdrColor, sceneBright = brightColor;
+        if (samples > 1) {
+            sceneColor = renderGraph.Create("HDR color MSAA", GL_RGBA16F, 1.0f, samples);
+            sceneBright = renderGraph.Create("Bright pass MSAA", GL_R11F_G11F_B10F, 1.0f, samples);
+        }
+        bool prepass = programState->DepthPrepass;
+        if (prepass) {
+            // lay down the final depth first, the shading pass then runs once per pixel for the visible surface only
+            renderGraph.AddPass("Depth pre-pass", [&]() {
+                drawOpaque(depthVariants, true);
+            }).Depth(sceneDepth).Time(&prepassTimer);
+        }
+        auto drawScene = [&]() {
+            if (prepass) {
+                glDepthFunc(GL_EQUAL);
+                glDepthMask(GL_FALSE);
+            }
+            drawOpaque(sceneVariants, false);
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+        };
+        if (deferred) {
+            // 12 bytes per pixel, see gbuffer.fs. The depth is the scene depth the forward passes test against later.
+            RenderGraph::Resource gAlbedoSpecular = renderGraph.Create("GBuffer albedo/specular", GL_RGBA8);
+            RenderGraph::Resource gNormal = renderGraph.Create("GBuffer normal", GL_RG16);
+            renderGraph.AddPass("GBuffer", drawScene)
+                .Write(gAlbedoSpecular).Write(gNormal).Depth(sceneDepth).Time(&opaqueTimer);
+            renderGraph.AddPass("Deferred lighting", [&, gAlbedoSpecular, gNormal, sceneDepth]() {
+                glDisable(GL_DEPTH_TEST);
+                glDisable(GL_CULL_FACE);
+                deferredLightingShader.use();
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.Texture(gAlbedoSpecular));
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.Texture(gNormal));
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.Texture(sceneDepth));
+                glActiveTexture(GL_TEXTURE0);
+                lightManager.Bind(deferredLightingShader);
+                lightClusters.Bind(deferredLightingShader, programState->ClusterHeatmap);
+                deferredLightingShader.setMat4("inverseViewProjection", glm::inverse(cameraBlock.data.projection * cameraBlock.data.view));
+                deferredLightingShader.setVec2("gBufferScale", renderGraph.UvScale(gAlbedoSpecular));
+                glBindVertexArray(quadVAO);
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+                glBindVertexArray(0);
+                glEnable(GL_DEPTH_TEST);
+            }).Read(gAlbedoSpecular).Read(gNormal).Read(sceneDepth).Write(sceneColor).Write(sceneBright).Time(&lightingTimer);
+        } else {
+            renderGraph.AddPass("Opaque shading", drawScene)
+                .Write(sceneColor).Write(sceneBright).Depth(sceneDepth).Time(&opaqueTimer);
+        }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        renderGraph.AddPass("Grass", [&]() {
+            glDisable(GL_CULL_FACE);
+            // the alpha tested grass edges get the coverage of their alpha instead of a hard cut
+            if (samples > 1)
+                glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+            blendingShader.use();
+            lightManager.Bind(blendingShader);
+            glBindVertexArray(grassVAO);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, grassTexture);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, grassTextureSpec);
+
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, grassInstances.Count());
+            glBindVertexArray(0);
+            glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+        }).Write(sceneColor).Write(sceneBright).Depth(sceneDepth).Time(&grassTimer);
+        renderGraph.AddPass("Skybox", [&]() {
+            glDepthFunc(GL_LEQUAL);
+            skyboxShader.use();
+            glBindVertexArray(skyboxVAO);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glDepthFunc(GL_LESS);
+        }).Write(sceneColor).Write(sceneBright).Depth(sceneDepth).Time(&skyboxTimer);
+        if (samples > 1) {
+            renderGraph.AddBlit("MSAA resolve", sceneColor, hdrColor).Time(&resolveTimer);
+            renderGraph.AddBlit("MSAA bright pass resolve", sceneBright, brightColor).Time(&resolveTimer);
+        }
 
-        bool horizontal = true, first_iteration = true;
-        unsigned int amount = 10;
-        blurShader.use();
-        for (unsigned int i = 0; i < amount; i++)
-        {
-            glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-            blurShader.setInt("horizontal", horizontal);
-            glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
+        // tone mapping into the window, upscaled with a sharpening filter when the scene was rendered smaller. FXAA
+        // needs the tone mapped image as input, the composite goes into a window size LDR target first then.
+        RenderGraph::Resource bloomColor = bloom.AddPasses(renderGraph, brightColor, programState->BloomLevels, &bloomTimer);
+        bool bloomEnabled = bBloom;
+        auto composite = renderGraph.AddPass("Tone mapping", [&, hdrColor, bloomColor, bloomEnabled]() {
+            glDisable(GL_DEPTH_TEST);
+            bloomShader.use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.Texture(hdrColor));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.Texture(bloomColor));
+            glActiveTexture(GL_TEXTURE0);
+            bloomShader.setInt("bloom", bloomEnabled);
+            bloomShader.setFloat("exposure", 0.1f);
+            bloomShader.setVec2("sceneScale", renderGraph.UvScale(hdrColor));
+            bloomShader.setVec2("bloomScale", renderGraph.UvScale(bloomColor));
+            bloomShader.setFloat("sharpness", 1.0f - dynamicResolution.Scale());
             glBindVertexArray(quadVAO);
             glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
             glBindVertexArray(0);
-            horizontal = !horizontal;
-            if (first_iteration)
-                first_iteration = false;
+            glEnable(GL_DEPTH_TEST);
+        });
+        composite.Read(hdrColor).Time(&postTimer);
+        if (bloomEnabled)
+            composite.Read(bloomColor);
+        if (antiAliasingMode == AntiAliasing::FXAA) {
+            RenderGraph::Resource toneMapped = renderGraph.CreateUnscaled("Tone mapped", GL_RGBA8);
+            composite.Write(toneMapped, false);
+            antiAliasing.AddFxaaPass(renderGraph, toneMapped, &fxaaTimer);
+        } else {
+            composite.Write(RenderGraph::BACKBUFFER, false).SideEffect();
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        bloomShader.use();
-        glActiveTexture(GL_TEXTURE0);
-
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);
-        bloomShader.setInt("bloom", bBloom);
-        bloomShader.setFloat("exposure", 0.1f);
-
-
-        glBindVertexArray(quadVAO);
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-        glBindVertexArray(0);
-
-
-        if (programState->ImGuiEnabled)
-            DrawImGui(programState);
+        {
+            GpuTimerScope frameScope(frameTimer);
+            renderGraph.Execute();
 
+            if (programState->ImGuiEnabled)
+                DrawImGui(programState, renderGraph, dynamicResolution, antiAliasing, profiler);
+        }
+        profiler.EndFrame(deltaTime * 1000.0);
+        if (profilingPlayback && cameraRecorder.GetState() != CameraRecorder::PLAYING &&
+            ++playbackProfileTail > GpuTimer::LATENCY) {
+            profiler.StopCsv();
+            profilingPlayback = false;
+        }
 
+        if (headless) {
+            double cpuMilliseconds = millisecondsSince(frameBegin);
+            headlessContext.Present();
+            glDisable(GL_CULL_FACE);
+            // GPU results arrive GpuTimer::LATENCY frames late, the first ones after the warm-up still belong to it
+            if (frameTimer.ResultCount() != frameTimerResults) {
+                frameTimerResults = frameTimer.ResultCount();
+                if (benchmarkFrame >= benchmark.warmupFrames + GpuTimer::LATENCY)
+                    benchmarkRecorder.gpuMs.push_back(frameTimer.LatestMilliseconds());
+            }
+            if (benchmarkFrame >= benchmark.warmupFrames) {
+                benchmarkRecorder.cpuMs.push_back(cpuMilliseconds);
+                benchmarkRecorder.frameMs.push_back(millisecondsSince(frameBegin));
+            }
+            benchmarkFrame++;
+            continue;
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
+        {
+            PROFILE_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
         glDisable(GL_CULL_FACE);
     }
 
-    programState->SaveToFile("resources/program_state.txt");
+    bool reportWritten = true;
+    if (headless) {
+        std::string settings = std::string(programState->DeferredShading ? "deferred" : "forward") +
+                               (programState->DepthPrepass ? " + depth pre-pass" : "") + ", AA " +
+                               AntiAliasing::Name(AntiAliasing::Effective(programState->AntiAliasingMode,
+                                                                          programState->DeferredShading));
+        reportWritten = benchmarkRecorder.WriteReport(benchmark, (const char*)glGetString(GL_RENDERER), settings);
+    } else {
+        programState->SaveToFile("resources/program_state.txt");
+    }
     delete programState;
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    TextureManager::Instance().Shutdown();
+    delete textureStreamer;
+    if (!headless) {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
     glDeleteVertexArrays(1, &skyboxVAO);
     glDeleteBuffers(1, &skyboxVAO);
     glDeleteVertexArrays(1, &grassVAO);
     glDeleteBuffers(1, &grassVAO);
     glDeleteVertexArrays(1, &quadVAO);
     glDeleteBuffers(1, &quadVAO);
+    glDeleteBuffers(1, &grassInstances.ID);
+    glDeleteBuffers(1, &cowInstances.ID);
+    glDeleteBuffers(1, &sunflowerInstances.ID);
+    glDeleteBuffers(1, &cameraBlock.ID);
+    lightManager.Delete();
+    lightClusters.Delete();
+    renderGraph.Delete();
+    for (ShaderVariants *variants : {&forwardVariants, &gBufferVariants, &depthVariants})
+        variants->Delete();
+    profiler.Delete();
+    if (headless) {
+        headlessContext.Delete();
+        return reportWritten ? 0 : 1;
+    }
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
@@ -779,21 +1019,20 @@ int main() {
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window) {
+    PROFILE_ZONE("processInput");
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(RIGHT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(UP, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(DOWN, deltaTime);
+    const std::pair<int, Camera_Movement> movementKeys[] = {
+            {GLFW_KEY_W, FORWARD}, {GLFW_KEY_S, BACKWARD}, {GLFW_KEY_A, LEFT},
+            {GLFW_KEY_D, RIGHT}, {GLFW_KEY_SPACE, UP}, {GLFW_KEY_X, DOWN}
+    };
+    for (const auto &movementKey : movementKeys) {
+        if (glfwGetKey(window, movementKey.first) == GLFW_PRESS) {
+            programState->camera.ProcessKeyboard(movementKey.second, deltaTime);
+            cameraInput.Press(movementKey.second);
+        }
+    }
     if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS){
         if(bBloom){
             bBloom = false;
@@ -827,17 +1066,23 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
     lastX = xpos;
     lastY = ypos;
 
-    if (programState->CameraMouseMovementUpdateEnabled)
+    if (programState->CameraMouseMovementUpdateEnabled) {
         programState->camera.ProcessMouseMovement(xoffset, yoffset);
+        cameraInput.mouseX += xoffset;
+        cameraInput.mouseY += yoffset;
+    }
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
     programState->camera.ProcessMouseScroll(yoffset);
+    cameraInput.scroll += yoffset;
 }
 
-void DrawImGui(ProgramState *programState) {
+void DrawImGui(ProgramState *programState, const RenderGraph &renderGraph, const DynamicResolution &dynamicResolution,
+               const AntiAliasing &antiAliasing, GpuProfiler &profiler) {
+    PROFILE_ZONE("DrawImGui");
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -855,9 +1100,53 @@ void DrawImGui(ProgramState *programState) {
         ImGui::DragFloat("pointLight.constant", &programState->pointLight.constant, 0.05, 0.0, 1.0);
         ImGui::DragFloat("pointLight.linear", &programState->pointLight.linear, 0.05, 0.0, 1.0);
         ImGui::DragFloat("pointLight.quadratic", &programState->pointLight.quadratic, 0.05, 0.0, 1.0);
+        ImGui::Checkbox("Light cluster heatmap", &programState->ClusterHeatmap);
+        ImGui::Checkbox("Deferred shading (F2)", &programState->DeferredShading);
+        ImGui::Checkbox("Depth pre-pass (F3)", &programState->DepthPrepass);
+        ImGui::SliderInt("Bloom levels", &programState->BloomLevels, 1, Bloom::MAX_LEVELS);
+        ImGui::Checkbox("Dynamic resolution (F4)", &programState->DynamicResolution);
+        ImGui::SliderFloat("Target GPU time (ms)", &programState->TargetFrameTime, 4.0f, 33.0f);
+        ImGui::Text("Render scale: %.2f", dynamicResolution.Scale());
+        ImGui::Combo("Anti-aliasing (F5)", &programState->AntiAliasingMode, "Off\0FXAA\0MSAA\0");
+        if (AntiAliasing::Effective(programState->AntiAliasingMode, programState->DeferredShading) != programState->AntiAliasingMode)
+            ImGui::Text("  MSAA needs forward shading, using FXAA");
+        // GPU time of a frame in every mode that ran for a while, switch through them to compare
+        ImGui::Text("GPU frame time by anti-aliasing:");
+        for (int mode = 0; mode < AntiAliasing::MODE_COUNT; mode++) {
+            if (antiAliasing.Milliseconds(mode) > 0.0)
+                ImGui::Text("  %s: %.2f ms", AntiAliasing::Name(mode), antiAliasing.Milliseconds(mode));
+            else
+                ImGui::Text("  %s: -", AntiAliasing::Name(mode));
+        }
+        ImGui::Text("Frame time: %.2f ms", deltaTime * 1000.0f);
+        ImGui::Text("Render graph: %u passes, %u culled, %zu targets (%.1f MB)", renderGraph.ExecutedPasses(),
+                    renderGraph.CulledPasses(), renderGraph.PooledTextures(), renderGraph.PooledBytes() / (1024.0 * 1024.0));
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("GPU profiler");
+        // rolling averages, passes that didn't run in a while keep their last value
+        for (size_t i = 0; i < profiler.TimerCount(); i++) {
+            const GpuTimer &timer = profiler.TimerAt(i);
+            if (timer.HasStatistics())
+                ImGui::Text("%-20s %6.2f ms %9.1fk prims %9.1fk frags", timer.name.c_str(), timer.Milliseconds(),
+                            timer.Primitives() / 1000.0, timer.FragmentInvocations() / 1000.0);
+            else
+                ImGui::Text("%-20s %6.2f ms", timer.name.c_str(), timer.Milliseconds());
+        }
+        if (profiler.Recording()) {
+            ImGui::Text("Recording to %s", profiler.CsvPath().c_str());
+            if (ImGui::Button("Stop recording"))
+                profiler.StopCsv();
+        } else if (ImGui::Button("Record CSV")) {
+            profiler.StartCsv("gpu_profile.csv");
+        }
         ImGui::End();
     }
 
+    DrawCpuProfiler();
+
     {
         ImGui::Begin("Camera info");
         const Camera& c = programState->camera;
@@ -865,6 +1154,21 @@ void DrawImGui(ProgramState *programState) {
         ImGui::Text("(Yaw, Pitch): (%f, %f)", c.Yaw, c.Pitch);
         ImGui::Text("Camera front: (%f, %f, %f)", c.Front.x, c.Front.y, c.Front.z);
         ImGui::Checkbox("Camera mouse update", &programState->CameraMouseMovementUpdateEnabled);
+
+        ImGui::Separator();
+        CameraRecorder::State state = cameraRecorder.GetState();
+        if (ImGui::Button(state == CameraRecorder::RECORDING ? "Stop recording (F6)" : "Record (F6)"))
+            ToggleCameraRecording();
+        ImGui::SameLine();
+        if (ImGui::Button(state == CameraRecorder::PLAYING ? "Stop playback (F7)" : "Play (F7)"))
+            ToggleCameraPlayback();
+        ImGui::Checkbox("Profile playback", &programState->ProfilePlayback);
+        if (state == CameraRecorder::RECORDING)
+            ImGui::Text("Recording: %zu frames, %.1f s", cameraRecorder.FrameCount(), cameraRecorder.Duration());
+        else if (state == CameraRecorder::PLAYING)
+            ImGui::Text("Playing: frame %u, %.1f s", cameraRecorder.PlaybackFrame(), cameraRecorder.Duration());
+        else
+            ImGui::Text("%s: %zu frames, %.1f s", CAMERA_RECORDING_FILE, cameraRecorder.FrameCount(), cameraRecorder.Duration());
         ImGui::End();
     }
 
@@ -872,6 +1176,55 @@ void DrawImGui(ProgramState *programState) {
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
+// flame graph of the last frame, one lane per thread, zones stacked by nesting depth
+void DrawCpuProfiler() {
+    ImGui::Begin("CPU profiler");
+#ifdef CPU_PROFILER_ENABLED
+    static bool paused = false;
+    static vector<CpuProfiler::ThreadCapture> capture;
+    static uint64_t frameBegin = 0, frameEnd = 0;
+    ImGui::Checkbox("Pause", &paused);
+    if (!paused)
+        capture = CpuProfiler::Instance().CaptureLastFrame(frameBegin, frameEnd);
+    ImGui::SameLine();
+    if (ImGui::Button("Save Chrome trace"))
+        CpuProfiler::Instance().WriteChromeTrace("cpu_trace.json");
+    double frameNanoseconds = frameEnd > frameBegin ? double(frameEnd - frameBegin) : 1.0;
+    ImGui::Text("Frame: %.2f ms", frameNanoseconds * 1e-6);
+
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    float width = ImGui::GetContentRegionAvail().x;
+    float rowHeight = ImGui::GetTextLineHeight() + 2.0f;
+    for (const CpuProfiler::ThreadCapture &thread : capture) {
+        if (thread.events.empty())
+            continue;
+        ImGui::Text("%s", thread.name.c_str());
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        uint32_t maxDepth = 0;
+        for (const CpuProfileEvent &event : thread.events) {
+            maxDepth = std::max(maxDepth, event.depth);
+            // zones that started in the previous frame or end in the next one are cut at the frame edges
+            double begin = event.begin > frameBegin ? double(event.begin - frameBegin) : 0.0;
+            double end = event.end < frameEnd ? double(event.end - frameBegin) : frameNanoseconds;
+            ImVec2 min(origin.x + float(begin / frameNanoseconds) * width, origin.y + event.depth * rowHeight);
+            ImVec2 max(std::max(min.x + 1.0f, origin.x + float(end / frameNanoseconds) * width), min.y + rowHeight - 1.0f);
+            // a stable color per zone name
+            size_t hash = std::hash<std::string>()(event.name);
+            ImU32 color = IM_COL32(96 + hash % 128, 96 + (hash >> 8) % 128, 96 + (hash >> 16) % 128, 255);
+            drawList->AddRectFilled(min, max, color);
+            if (ImGui::CalcTextSize(event.name).x + 4.0f < max.x - min.x)
+                drawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32_BLACK, event.name);
+            if (ImGui::IsMouseHoveringRect(min, max))
+                ImGui::SetTooltip("%s: %.3f ms", event.name, (event.end - event.begin) * 1e-6);
+        }
+        ImGui::Dummy(ImVec2(width, (maxDepth + 1) * rowHeight));
+    }
+#else
+    ImGui::Text("Compiled out, configure with -DCPU_PROFILER=ON");
+#endif
+    ImGui::End();
+}
+
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
     if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
         programState->ImGuiEnabled = !programState->ImGuiEnabled;
@@ -882,71 +1235,42 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
             glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
         }
     }
+    if (key == GLFW_KEY_F2 && action == GLFW_PRESS)
+        programState->DeferredShading = !programState->DeferredShading;
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS)
+        programState->DepthPrepass = !programState->DepthPrepass;
+    if (key == GLFW_KEY_F4 && action == GLFW_PRESS)
+        programState->DynamicResolution = !programState->DynamicResolution;
+    if (key == GLFW_KEY_F5 && action == GLFW_PRESS)
+        programState->AntiAliasingMode = (programState->AntiAliasingMode + 1) % AntiAliasing::MODE_COUNT;
+    if (key == GLFW_KEY_F6 && action == GLFW_PRESS)
+        ToggleCameraRecording();
+    if (key == GLFW_KEY_F7 && action == GLFW_PRESS)
+        ToggleCameraPlayback();
 }
 
-unsigned int loadTexture(char const * path)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+void ToggleCameraRecording() {
+    if (cameraRecorder.GetState() == CameraRecorder::RECORDING)
+        cameraRecorder.StopRecording(CAMERA_RECORDING_FILE);
+    else if (cameraRecorder.GetState() == CameraRecorder::IDLE)
+        cameraRecorder.StartRecording(glfwGetTime());
+}
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+// always plays the file, which may come from another build or session
+void ToggleCameraPlayback() {
+    if (cameraRecorder.GetState() == CameraRecorder::PLAYING)
+        cameraRecorder.StopPlayback();
+    else if (cameraRecorder.GetState() == CameraRecorder::IDLE && cameraRecorder.Load(CAMERA_RECORDING_FILE))
+        cameraRecorder.StartPlayback();
+}
 
-    return textureID;
+unsigned int loadTexture(char const * path)
+{
+    // transparent textures (grass) are clamped to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
+    return TextureManager::Instance().Acquire2D(path, true);
 }
 
 
 unsigned int loadCubemap(std::vector<std::string>& faces) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    unsigned char *data;
-
-    for (int i = 0; i < faces.size(); i++) {
-        data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE,
-                         data);
-        } else {
-            std::cerr << "Failed to load cube map texture face\n";
-            return -1;
-        }
-        stbi_image_free(data);
-    }
-
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
+    return TextureManager::Instance().AcquireCubemap(faces);
 }
@@ -0,0 +1,265 @@
+// Offline texture cooker: converts the images under resources/objects and resources/textures into block compressed
+// KTX files (<image>.ktx next to each image) with a precomputed mip chain. The runtime picks a cooked file up in
+// LoadTextureImage when it is at least as new as its source and the GPU supports its format.
+//
+// The format is chosen by the role a texture plays in the models' .mtl files:
+//   texture_normal (map_Bump/bump)           -> BC5 (x, y; z is reconstructed when sampling)
+//   texture_specular (map_Ks)                -> BC1
+//   texture_diffuse and everything else      -> BC1, or BC7 if the image has transparent texels (BC3 with --no-bc7)
+// Images that no .mtl references fall back to their file name ("normal", "spec" in the name).
+//
+// usage: texture_cooker [--force] [--no-bc7] [root directories...]   (default: resources/objects resources/textures)
+
+#include <learnopengl/ktx.h>
+#include <learnopengl/texture_compress.h>
+#include <stb_image.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+enum class TextureRole {
+    Diffuse,
+    Specular,
+    Normal
+};
+
+static std::string toLower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+static bool fileExists(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+static bool isImage(const std::string &name)
+{
+    std::string lower = toLower(name);
+    for (const char *ext : {".png", ".jpg", ".jpeg", ".tga", ".bmp"})
+    {
+        std::string e(ext);
+        if (lower.size() > e.size() && lower.compare(lower.size() - e.size(), e.size(), e) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void listDirectory(const std::string &dir, std::vector<std::string> &files, std::vector<std::string> &dirs)
+{
+    DIR *handle = opendir(dir.c_str());
+    if (!handle)
+        return;
+    while (dirent *entry = readdir(handle))
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        std::string path = dir + "/" + name;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            dirs.push_back(path);
+        else if (S_ISREG(st.st_mode))
+            files.push_back(path);
+    }
+    closedir(handle);
+}
+
+// reads the texture references of a .mtl file. The file name is whatever follows the keyword and its options,
+// names may contain spaces, so the longest suffix that exists on disk wins.
+static void readMaterialRoles(const std::string &mtlPath, std::map<std::string, TextureRole> &roles)
+{
+    std::ifstream in(mtlPath);
+    std::string directory = mtlPath.substr(0, mtlPath.find_last_of('/'));
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        std::istringstream tokens(line);
+        std::string keyword;
+        tokens >> keyword;
+        keyword = toLower(keyword);
+        TextureRole role;
+        if (keyword == "map_kd")
+            role = TextureRole::Diffuse;
+        else if (keyword == "map_ks")
+            role = TextureRole::Specular;
+        else if (keyword == "map_bump" || keyword == "bump" || keyword == "norm" || keyword == "map_kn")
+            role = TextureRole::Normal;
+        else
+            continue;
+
+        std::string rest = line.substr(line.find_first_not_of(" \t") + keyword.size());
+        for (size_t start = 0; start < rest.size(); start++)
+        {
+            if (start > 0 && rest[start - 1] != ' ' && rest[start - 1] != '\t')
+                continue;
+            std::string candidate = directory + "/" + rest.substr(start);
+            if (fileExists(candidate))
+            {
+                // a normal map role wins over anything else, it changes the channel layout
+                auto it = roles.find(candidate);
+                if (it == roles.end() || role == TextureRole::Normal)
+                    roles[candidate] = role;
+                break;
+            }
+        }
+    }
+}
+
+static TextureRole roleFromName(const std::string &path)
+{
+    std::string name = toLower(path.substr(path.find_last_of('/') + 1));
+    if (name.find("normal") != std::string::npos)
+        return TextureRole::Normal;
+    if (name.find("spec") != std::string::npos)
+        return TextureRole::Specular;
+    return TextureRole::Diffuse;
+}
+
+static const char *formatName(BlockFormat format)
+{
+    switch (format)
+    {
+        case BlockFormat::BC1: return "BC1";
+        case BlockFormat::BC3: return "BC3";
+        case BlockFormat::BC4: return "BC4";
+        case BlockFormat::BC5: return "BC5";
+        case BlockFormat::BC7: return "BC7";
+    }
+    return "?";
+}
+
+static bool cook(const std::string &path, TextureRole role, bool allowBC7)
+{
+    int width, height, components;
+    unsigned char *pixels = stbi_load(path.c_str(), &width, &height, &components, 4);
+    if (!pixels)
+    {
+        std::cout << "  failed to load " << path << std::endl;
+        return false;
+    }
+
+    bool transparent = false;
+    for (size_t i = 0; i < size_t(width) * height && !transparent; i++)
+        transparent = pixels[i * 4 + 3] != 255;
+
+    BlockFormat format;
+    KtxTexture ktx;
+    if (role == TextureRole::Normal)
+    {
+        format = BlockFormat::BC5;
+        ktx.internalFormat = GL_COMPRESSED_RG_RGTC2;
+        ktx.baseInternalFormat = GL_RG;
+    }
+    else if (transparent && role == TextureRole::Diffuse)
+    {
+        format = allowBC7 ? BlockFormat::BC7 : BlockFormat::BC3;
+        ktx.internalFormat = allowBC7 ? GL_COMPRESSED_RGBA_BPTC_UNORM : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        ktx.baseInternalFormat = GL_RGBA;
+    }
+    else
+    {
+        format = BlockFormat::BC1;
+        ktx.internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        ktx.baseInternalFormat = GL_RGB;
+    }
+    ktx.width = width;
+    ktx.height = height;
+
+    std::vector<unsigned char> level(pixels, pixels + size_t(width) * height * 4);
+    stbi_image_free(pixels);
+    int w = width, h = height;
+    for (;;)
+    {
+        ktx.levels.push_back(CompressImage(level.data(), w, h, format));
+        if (w == 1 && h == 1)
+            break;
+        int nextW, nextH;
+        level = DownsampleImage(level.data(), w, h, nextW, nextH);
+        w = nextW;
+        h = nextH;
+    }
+
+    std::string cookedPath = CookedTexturePath(path);
+    if (!WriteKtx(cookedPath, ktx))
+    {
+        std::cout << "  failed to write " << cookedPath << std::endl;
+        return false;
+    }
+    std::cout << "  " << formatName(format) << " " << width << "x" << height << " " << ktx.levels.size() << " levels  " << path << std::endl;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    bool force = false;
+    bool allowBC7 = true;
+    std::vector<std::string> roots;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--force")
+            force = true;
+        else if (arg == "--no-bc7")
+            allowBC7 = false;
+        else
+            roots.push_back(arg);
+    }
+    if (roots.empty())
+        roots = {"resources/objects", "resources/textures"};
+
+    std::vector<std::string> images;
+    std::map<std::string, TextureRole> roles;
+    std::vector<std::string> pending = roots;
+    while (!pending.empty())
+    {
+        std::string dir = pending.back();
+        pending.pop_back();
+        std::vector<std::string> files, dirs;
+        listDirectory(dir, files, dirs);
+        pending.insert(pending.end(), dirs.begin(), dirs.end());
+        for (const std::string &file : files)
+        {
+            if (toLower(file).size() > 4 && toLower(file).compare(file.size() - 4, 4, ".mtl") == 0)
+                readMaterialRoles(file, roles);
+            else if (isImage(file))
+                images.push_back(file);
+        }
+    }
+    std::sort(images.begin(), images.end());
+
+    stbi_set_flip_vertically_on_load(false);
+    unsigned int cooked = 0, skipped = 0, failed = 0;
+    for (const std::string &image : images)
+    {
+        struct stat sourceStat, cookedStat;
+        if (!force && stat(image.c_str(), &sourceStat) == 0 && stat(CookedTexturePath(image).c_str(), &cookedStat) == 0 &&
+            cookedStat.st_mtime >= sourceStat.st_mtime)
+        {
+            skipped++;
+            continue;
+        }
+        auto it = roles.find(image);
+        if (cook(image, it != roles.end() ? it->second : roleFromName(image), allowBC7))
+            cooked++;
+        else
+            failed++;
+    }
+    std::cout << cooked << " cooked, " << skipped << " up to date, " << failed << " failed" << std::endl;
+    return failed ? 1 : 0;
+}